@@ -0,0 +1,914 @@
+#include <stdarg.h>
+#include <klib/types.h>
+#include <klib/string.h>
+#include <klib/format.h>
+#include <klib/intx.h>
+#include <klib/elf.h>
+#include <klib/dwarf.h>
+#include <klib/crypto/rsa.h>
+#include <klib/crypto/sha256.h>
+
+// Hosted microbenchmarks for klib's hot paths. Every case is timed with
+// rdtsc and reported as one CSV row on stdout:
+//
+//   group,case,param,iters,cycles_per_op
+//
+// param is the input size in bytes where that makes sense, 0 otherwise.
+// cycles_per_op is the best of SAMPLES runs of iters calls each. Lines
+// starting with '#' are comments, e.g. the string variants CPUID selected.
+// Each group first checks its kernels' results against a reference and
+// reports a mismatch as a '# FAIL' line; the exit status is then nonzero.
+
+extern "C" {
+void *malloc(usize size);
+int open(const char *path, int flags, ...);
+long read(int fd, void *buf, usize count);
+long write(int fd, const void *buf, usize count);
+int close(int fd);
+void *mmap(void *addr, usize len, int prot, int flags, int fd, long off);
+int mprotect(void *addr, usize len, int prot);
+}
+
+// Linux x86-64 values, for the guard page under the string checks.
+#define PROT_NONE 0
+#define PROT_READ 1
+#define PROT_WRITE 2
+#define MAP_PRIVATE 0x02
+#define MAP_ANONYMOUS 0x20
+
+#define SAMPLES 15
+#define BUF_SIZE (2 << 20)
+
+static inline u64 tsc_begin() {
+  u32 lo, hi;
+  asm volatile("lfence\n\trdtsc" : "=a"(lo), "=d"(hi) : : "memory");
+  return ((u64)hi << 32) | lo;
+}
+
+static inline u64 tsc_end() {
+  u32 lo, hi;
+  asm volatile("rdtscp\n\tlfence" : "=a"(lo), "=d"(hi) : : "rcx", "memory");
+  return ((u64)hi << 32) | lo;
+}
+
+// Keeps a value alive without letting the compiler reason about it.
+template<typename T>
+static inline void keep(const T& v) {
+  asm volatile("" : : "r"(&v) : "memory");
+}
+
+static void out(const char *format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  usize n = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  write(1, buf, n < sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+static int failures;
+
+static void check(const char *group, const char *name, bool ok) {
+  if (ok) return;
+  out("# FAIL %s,%s\n", group, name);
+  failures++;
+}
+
+template<typename F>
+static void run(const char *group, const char *name, usize param, usize iters, F&& fn) {
+  for (usize i = 0; i < iters; i++) fn();
+
+  u64 best = ~0ULL;
+  for (int s = 0; s < SAMPLES; s++) {
+    u64 t0 = tsc_begin();
+    for (usize i = 0; i < iters; i++) fn();
+    u64 t1 = tsc_end();
+    if (t1 - t0 < best) best = t1 - t0;
+  }
+
+  u64 centi = best * 100 / iters;
+  out("%s,%s,%lu,%lu,%lu.%02lu\n", group, name, param, iters, centi / 100, centi % 100);
+}
+
+static usize iters_for(usize bytes) {
+  usize n = (4 << 20) / (bytes ? bytes : 1);
+  return n < 16 ? 16 : n;
+}
+
+static const usize mem_sizes[] = {8, 64, 256, 1024, 4096, 65536, 1 << 20};
+static const usize str_sizes[] = {16, 64, 256, 4096};
+
+static u8 *dst_buf;
+static u8 *src_buf;
+
+static bool bytes_equal(const u8 *a, const u8 *b, usize n) {
+  for (usize i = 0; i < n; i++) {
+    if (a[i] != b[i]) return false;
+  }
+  return true;
+}
+
+static bool bytes_all(const u8 *a, u8 v, usize n) {
+  for (usize i = 0; i < n; i++) {
+    if (a[i] != v) return false;
+  }
+  return true;
+}
+
+static void check_memory() {
+  static u8 ref[4096 + 64];
+  for (usize i = 0; i < BUF_SIZE + 64; i++) src_buf[i] = (u8)(i * 7 + (i >> 8));
+  for (usize size = 0; size <= 4096; size = size < 64 ? size + 1 : size * 2) {
+    memset(dst_buf, 0, size + 16);
+    memcpy(dst_buf + 1, src_buf + 3, size);
+    check("memcpy", "unaligned", bytes_equal(dst_buf + 1, src_buf + 3, size) && dst_buf[0] == 0 && dst_buf[size + 1] == 0);
+
+    for (usize i = 0; i < size + 8; i++) ref[i] = src_buf[i];
+    for (usize i = size; i-- > 0;) ref[i + 8] = ref[i];
+    memcpy(dst_buf, src_buf, size + 8);
+    memmove(dst_buf + 8, dst_buf, size);
+    check("memmove", "backward", bytes_equal(dst_buf, ref, size + 8));
+
+    memset(dst_buf + 1, 0x5a, size);
+    check("memset", "unaligned", bytes_all(dst_buf + 1, 0x5a, size) && dst_buf[size + 1] == ref[size + 1]);
+  }
+  memcpy(dst_buf, src_buf, BUF_SIZE);
+  check("memcpy", "aligned", bytes_equal(dst_buf, src_buf, BUF_SIZE));
+}
+
+static void check_strings() {
+  char *a = (char *)dst_buf;
+  char *b = (char *)src_buf;
+  for (usize size = 1; size <= 4096; size = size < 64 ? size + 1 : size * 2) {
+    memset(a, 'a', size - 1);
+    memset(b, 'a', size - 1);
+    a[size - 1] = 0;
+    b[size - 1] = 0;
+    check("strlen", "plain", strlen(a) == size - 1 && strlen(a + size / 2) == (size - 1) - size / 2);
+    check("strcmp", "equal", strcmp(a, b) == 0);
+    check("memcmp", "equal", memcmp(a, b, size) == 0);
+    if (size > 1) {
+      b[size - 2] = 'b';
+      check("strcmp", "less", strcmp(a, b) < 0 && strcmp(b, a) > 0);
+      check("memcmp", "less", memcmp(a, b, size) < 0 && memcmp(b, a, size) > 0);
+    }
+  }
+}
+
+static const void *ref_memchr(const void *s, int c, usize n) {
+  const u8 *p = (const u8 *)s;
+  for (usize i = 0; i < n; i++) {
+    if (p[i] == (u8)c) return p + i;
+  }
+  return nullptr;
+}
+
+static const void *ref_memrchr(const void *s, int c, usize n) {
+  const u8 *p = (const u8 *)s;
+  for (usize i = n; i-- > 0;) {
+    if (p[i] == (u8)c) return p + i;
+  }
+  return nullptr;
+}
+
+static const char *ref_strchr(const char *s, int c) {
+  for (;; s++) {
+    if (*s == (char)c) return s;
+    if (!*s) return nullptr;
+  }
+}
+
+static usize ref_span(const char *s, const char *set, bool in) {
+  usize n = 0;
+  for (; s[n]; n++) {
+    bool found = false;
+    for (const char *d = set; *d; d++) found |= *d == s[n];
+    if (found != in) break;
+  }
+  return n;
+}
+
+// The word-at-a-time scans against byte loops, on strings that end right
+// before an unmapped page so an overread past the terminator or past n
+// faults instead of passing unnoticed.
+static void check_search() {
+  const usize page = 4096;
+  u8 *map = (u8 *)mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == (u8 *)-1 || mprotect(map + page, page, PROT_NONE) != 0) {
+    out("# cannot map a guard page, skipping search checks\n");
+    return;
+  }
+  u8 *guard = map + page;
+  static const int bytes[] = {'a', 'c', 'g', 'z', 0xe1, 0x161};
+  static const int chars[] = {'a', 'd', 'z', 0xe1, 0};
+  static const char *const sets[] = {"abc", "defg", "\xe1\xe2" "a", "z", ""};
+  for (usize len = 0; len <= 80; len++) {
+    u8 *s = guard - len;
+    for (usize i = 0; i < len; i++) s[i] = 'a' + i % 7 + (i % 11 == 10 ? 0x80 : 0);
+    for (int c : bytes) {
+      check("memchr", "guard", memchr(s, c, len) == ref_memchr(s, c, len));
+      check("memrchr", "guard", memrchr(s, c, len) == ref_memrchr(s, c, len));
+      for (usize off = 1; off < 8 && off < len; off++) {
+        check("memchr", "offset", memchr(s + off, c, len - off) == ref_memchr(s + off, c, len - off));
+        check("memrchr", "offset", memrchr(s, c, len - off) == ref_memrchr(s, c, len - off));
+      }
+    }
+    if (len == 0) continue;
+    // the same bytes as a C string whose terminator is the last mapped byte
+    s[len - 1] = 0;
+    const char *str = (const char *)s;
+    check("strlen", "guard", strlen(str) == len - 1);
+    for (int c : chars) {
+      check("strchr", "guard", strchr(str, c) == ref_strchr(str, c));
+    }
+    for (const char *set : sets) {
+      check("strspn", "guard", strspn(str, set) == ref_span(str, set, true));
+      check("strcspn", "guard", strcspn(str, set) == ref_span(str, set, false));
+    }
+  }
+}
+
+// strtok_r and the non-mutating tokenizer on the same inputs, which must
+// give the same tokens.
+static void check_tokens() {
+  static const char *const inputs[] = {
+    "", ",,, ", "one", "  root=/dev/sda1 ro,,quiet  console=ttyS0,115200 ", "a,b,,c", ",x,",
+  };
+  static const char *const delims = " ,";
+  for (const char *in : inputs) {
+    char copy[128];
+    strcpy(copy, in);
+    usize len = strlen(in);
+    struct str_tokenizer tok;
+    str_tokenizer_init(&tok, in, len, delims);
+    char *save = nullptr;
+    char *t = strtok_r(copy, delims, &save);
+    struct str_view v;
+    bool ok = true;
+    while (str_tokenizer_next(&tok, &v)) {
+      ok &= t && strlen(t) == v.len && memcmp(t, v.ptr, v.len) == 0;
+      ok &= v.ptr >= in && v.ptr + v.len <= in + len;
+      t = t ? strtok_r(nullptr, delims, &save) : nullptr;
+    }
+    check("strtok_r", "tokens", ok && !t);
+  }
+
+  // two interleaved tokenizations keep separate positions
+  char outer[] = "a b c";
+  char inner[] = "1,2";
+  char *so, *si;
+  char *o1 = strtok_r(outer, " ", &so);
+  char *i1 = strtok_r(inner, ",", &si);
+  char *o2 = strtok_r(nullptr, " ", &so);
+  char *i2 = strtok_r(nullptr, ",", &si);
+  check("strtok_r", "nested", strcmp(o1, "a") == 0 && strcmp(o2, "b") == 0 && strcmp(i1, "1") == 0
+        && strcmp(i2, "2") == 0 && !strtok_r(nullptr, ",", &si));
+}
+
+static void bench_memory() {
+  check_memory();
+  for (usize size : mem_sizes) {
+    run("memcpy", "aligned", size, iters_for(size), [&] {
+      memcpy(dst_buf, src_buf, size);
+    });
+    run("memcpy", "unaligned", size, iters_for(size), [&] {
+      memcpy(dst_buf + 1, src_buf + 3, size);
+    });
+    run("memmove", "backward", size, iters_for(size), [&] {
+      memmove(dst_buf + 8, dst_buf, size);
+    });
+    run("memset", "aligned", size, iters_for(size), [&] {
+      memset(dst_buf, 0x5a, size);
+    });
+  }
+}
+
+static void bench_strings() {
+  check_strings();
+  check_search();
+  check_tokens();
+  char *a = (char *)dst_buf;
+  char *b = (char *)src_buf;
+  for (usize size : str_sizes) {
+    memset(a, 'a', size - 1);
+    memset(b, 'a', size - 1);
+    a[size - 1] = 0;
+    b[size - 1] = 0;
+    run("strlen", "plain", size, iters_for(size), [&] {
+      keep(strlen(a));
+    });
+    run("strcmp", "equal", size, iters_for(size), [&] {
+      keep(strcmp(a, b));
+    });
+    run("memcmp", "equal", size, iters_for(size), [&] {
+      keep(memcmp(a, b, size));
+    });
+    run("memchr", "miss", size, iters_for(size), [&] {
+      keep(memchr(a, 'b', size));
+    });
+    run("strspn", "all", size, iters_for(size), [&] {
+      keep(strspn(a, "abc"));
+    });
+  }
+}
+
+// Collects streamed output so the sink paths can be compared as strings.
+struct sink_buf {
+  char data[1024];
+  usize len;
+  usize calls;
+  void operator()(const char *s, usize n) {
+    memcpy(data + len, s, n);
+    len += n;
+    data[len] = 0;
+    calls++;
+  }
+};
+
+static void check_kformat(const u512& big) {
+  char buf[512];
+  char want[512];
+  char text[] = "hello";
+  const char *ctext = text;
+  auto expect = [&](const char *name, const char *w) { check("kformat", name, strcmp(buf, w) == 0); };
+
+  kformat(buf, sizeof(buf), KFMT("%d|%u|%#x|%08d|%a|%c|%%"), -123456, 42u, 0xdeadbeefcafeUL, 4242, 7, 'z');
+  expect("ints", "-123456|42|0xdeadbeefcafe|00004242|07|z|%");
+  kformat(buf, sizeof(buf), KFMT("[%s] [%s] [%6s]"), text, ctext, str_view{text + 1, 3});
+  expect("s", "[hello] [hello] [   ell]");
+  // %p of a char * is its address, whatever it points to
+  kformat(buf, sizeof(buf), KFMT("%p %p"), text, ctext);
+  sprintf(want, "%p %p", (void *)text, (void *)ctext);
+  expect("p", want);
+  kformat(buf, sizeof(buf), KFMT("%qx"), big);
+  sprintf(want, "%qx", big);
+  expect("qx", want);
+  kformat(buf, sizeof(buf), KFMT("%qd"), big);
+  sprintf(want, "%qd", big);
+  expect("qd", want);
+  check("kformat", "truncate", kformat(buf, 4, KFMT("%s"), "abcdef") == 6 && strcmp(buf, "abc") == 0);
+
+  // Past FMT_CHUNK bytes the sinks are called more than once
+  sink_buf sink = {};
+  usize n = kformat_to(sink, KFMT("%qx/%qd/%s"), big, big, text);
+  sprintf(want, "%qx/%qd/%s", big, big, text);
+  check("kformat", "to", n == strlen(want) && strcmp(sink.data, want) == 0 && sink.calls > 1);
+  sink = {};
+  n = format_to(sink, "%qx/%qd/%s", big, big, text);
+  check("format_to", "functor", n == strlen(want) && strcmp(sink.data, want) == 0 && sink.calls > 1);
+}
+
+static void bench_vformat() {
+  char buf[512];
+  u512 big = u512::from_hex("c0ffee0123456789abcdef0123456789abcdef0123456789abcdef0123456789"
+                            "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789");
+  auto expect = [&](const char *name, const char *want) { check("vsprintf", name, strcmp(buf, want) == 0); };
+  sprintf(buf, "%d", -123456);
+  expect("d", "-123456");
+  sprintf(buf, "%lu", 18446744073709551615UL);
+  expect("lu", "18446744073709551615");
+  sprintf(buf, "%#lx", 0xdeadbeefcafeUL);
+  expect("#lx", "0xdeadbeefcafe");
+  sprintf(buf, "%08d", 4242);
+  expect("08d", "00004242");
+  sprintf(buf, "%qx", big);
+  expect("qx", "c0ffee0123456789abcdef0123456789abcdef0123456789abcdef0123456789"
+               "abcdef0123456789abcdef0123456789abcdef0123456789abcdef0123456789");
+  sprintf(buf, "%qd", big);
+  expect("qd", "1010821581571782236686805647000882479679685308325824362138155726128236572571943956792273677632565"
+               "2593682321034222288513637504479752383514508131756597929865");
+  sprintf(buf, "[%a:%a:%a] %s: irq %d at %p (%#x)\n", 12, 3, 45, "ahci", 11, (void *)0xffffffff80001000UL, 0x1f);
+  expect("log_line", "[12:03:45] ahci: irq 11 at 0xffffffff80001000 (0x1f)\n");
+  check_kformat(big);
+
+  usize iters = 20000;
+  run("vsprintf", "d", 0, iters, [&] { sprintf(buf, "%d", -123456); keep(buf); });
+  run("vsprintf", "lu", 0, iters, [&] { sprintf(buf, "%lu", 18446744073709551615UL); keep(buf); });
+  run("vsprintf", "#lx", 0, iters, [&] { sprintf(buf, "%#lx", 0xdeadbeefcafeUL); keep(buf); });
+  run("vsprintf", "08d", 0, iters, [&] { sprintf(buf, "%08d", 4242); keep(buf); });
+  run("vsprintf", "s", 0, iters, [&] { sprintf(buf, "%s", "the quick brown fox"); keep(buf); });
+  run("vsprintf", "qx", 0, iters, [&] { sprintf(buf, "%qx", big); keep(buf); });
+  run("vsprintf", "qd", 0, iters / 10, [&] { sprintf(buf, "%qd", big); keep(buf); });
+  run("vsprintf", "log_line", 0, iters, [&] {
+    sprintf(buf, "[%a:%a:%a] %s: irq %d at %p (%#x)\n", 12, 3, 45, "ahci", 11, (void *)0xffffffff80001000UL, 0x1f);
+    keep(buf);
+  });
+  run("kformat", "qx", 0, iters, [&] { kformat(buf, sizeof(buf), KFMT("%qx"), big); keep(buf); });
+  run("kformat", "log_line", 0, iters, [&] {
+    kformat(buf, sizeof(buf), KFMT("[%a:%a:%a] %s: irq %d at %p (%#x)\n"), 12, 3, 45, "ahci", 11,
+            (void *)0xffffffff80001000UL, 0x1f);
+    keep(buf);
+  });
+}
+
+static void bench_intx() {
+  u512 a = 0xf1e2d3c4b5a697887766554433221100ffeeddccbbaa99887766554433221100'0123456789abcdeffedcba987654321000112233445566778899aabbccddeeff_u512;
+  u512 b = 0x123456789abcdef0fedcba9876543210deadbeefcafebabe0011223344556677_u512;
+  u512 m = 0xd94d889e88853dd89769a18015a0a2e6bf82bf356fe14f251fb4f5e2df0d9f9b'f68a7612d86a2b9da7b3ea8c3b1fbd4a1fe08b5a2e16d4a9b5c6d7e8f9a0b1c3_u512;
+  u512 e = 0x10001_u512;
+  u512 r;
+
+  // Identities, and results computed with Python's pow() and %
+  u512 lo, hi, q = a / b;
+  u512::mul_wide(a, b, lo, hi);
+  check("u512", "add", a + b - b == a);
+  check("u512", "mul", a * b == lo);
+  check("u512", "mul_wide", hi == 0x113366ab0066de57bff2aba69f5178d22d9265078bb64bc266183aab0799fab2_u512);
+  u512::sqr_wide(a, lo, hi);
+  u512 lo2, hi2;
+  u512::mul_wide(a, a, lo2, hi2);
+  check("u512", "sqr_wide", lo == lo2 && hi == hi2);
+  check("u512", "shl", (a << 37) == a * u512(1ULL << 37));
+  check("u512", "div", q * b + a % b == a && a % b < b);
+  check("u512", "from_dec",
+        u512::from_dec("13407807929942597099574024998205846127479365820592393377723561443721764030073546976801874298166903427690031858186486050853753882811946569946433649006084095") == ~u512(0));
+  u512 ab = 0x3d03e428cb657329094ddefeafe1a459ce78b8b21742022f85777a2bbac5e7d'0dad7d3115aa78e437331b1544b7f67d7b552a44f9159cf73371fc86b1d7c632_u512;
+  u512 ae = 0xb4dd8f00e2d78a0b9b4bbe06b906434adc14efd998240613569ad6570620b289'6b0beb97b52148b220a240c1fbe76370d4b85a68b4a58c05117f57c7ec7d3f4b_u512;
+  u512 ab_full = 0xc717c5ee375197f85fc30db7e5aa43ac966cc3c58de6d0919ea832834f04c5b2'8af0c85ca805cc2939ff897264e9d640f114feba6b818bb6b3349f3709a6ca8e_u512;
+  u512 ab_even = 0xab204c368022b8b38ce7e2f79f63c4d5cbecca3daf2854938ade5b8f0bdcbe99'd55c9834e5c5d65fe06af3803873b18e5b073566df412a60b9614eaccabb02a1_u512;
+  check("u512", "mulmod", u512::mulmod(a, b, m) == ab);
+  check("u512", "expmod_e65537", u512::expmod(a, e, m) == ae);
+  check("u512", "expmod_full", u512::expmod(a, b, m) == ab_full);
+  check("u512", "expmod_even", u512::expmod(a, b, m << 1) == ab_even);
+  run("u512", "add", 64, 100000, [&] { r = a + b; keep(r); });
+  run("u512", "sub", 64, 100000, [&] { r = a - b; keep(r); });
+  run("u512", "mul", 64, 100000, [&] { r = a * b; keep(r); });
+  run("u512", "mul_wide", 64, 100000, [&] { u512 hi; u512::mul_wide(a, b, r, hi); keep(r); keep(hi); });
+  run("u512", "sqr_wide", 64, 100000, [&] { u512 hi; u512::sqr_wide(a, r, hi); keep(r); keep(hi); });
+  run("u512", "mulmod", 64, 20000, [&] { r = u512::mulmod(a, b, m); keep(r); });
+  run("u512", "shl", 64, 100000, [&] { r = a << 37; keep(r); });
+  run("u512", "div", 64, 200, [&] { r = a / b; keep(r); });
+  run("u512", "mod", 64, 200, [&] { r = a % b; keep(r); });
+  run("u512", "from_dec", 64, 200, [&] {
+    r = u512::from_dec("13407807929942597099574024998205846127479365820592393377723561443721764030073546976801874298166903427690031858186486050853753882811946569946433649006084095");
+    keep(r);
+  });
+  run("u512", "expmod_e65537", 64, 2, [&] { r = u512::expmod(a, e, m); keep(r); });
+  run("u512", "expmod_full", 64, 1, [&] { r = u512::expmod(a, b, m); keep(r); });
+  Montgomery<8> mont(m);
+  u512 am = mont.to_mont(a % m);
+  check("u512", "mont_exp_window", mont.from_mont(mont.exp(am, b)) == ab_full);
+  check("u512", "mont_exp_consttime", mont.from_mont(mont.exp_consttime(am, b)) == ab_full);
+  run("u512", "mont_exp_window", 64, 1, [&] { r = mont.exp(am, b); keep(r); });
+  run("u512", "mont_exp_consttime", 64, 1, [&] { r = mont.exp_consttime(am, b); keep(r); });
+  u512 even = m << 1;
+  run("u512", "expmod_even", 64, 1, [&] { r = u512::expmod(a, b, even); keep(r); });
+
+  static u64 wa[64], wb[64], wr[128];
+  for (int i = 0; i < 64; i++) {
+    wa[i] = a.limbs[i % NLIMBS_512] ^ i;
+    wb[i] = m.limbs[i % NLIMBS_512] + i;
+  }
+  u256 a256 = u256::from_hex("f1e2d3c4b5a697887766554433221100ffeeddccbbaa99887766554433221100");
+  u256 m256 = u256::from_hex("d94d889e88853dd89769a18015a0a2e6bf82bf356fe14f251fb4f5e2df0d9f9b");
+  u256 r256;
+  check("u256", "expmod_full",
+        u256::expmod(a256, a256, m256) == u256::from_hex("64bd10f4f5904dd2069a5beed00427d73695fc60033b26d1840594dfb957e710"));
+  run("u256", "mul", 32, 100000, [&] { r256 = a256 * m256; keep(r256); });
+  run("u256", "mulmod", 32, 20000, [&] { r256 = u256::mulmod(a256, a256, m256); keep(r256); });
+  run("u256", "expmod_full", 32, 10, [&] { r256 = u256::expmod(a256, a256, m256); keep(r256); });
+
+  u2048 a2048, m2048;
+  for (usize i = 0; i < u2048::LIMBS; i++) {
+    a2048.limbs[i] = a.limbs[i % NLIMBS_512] * (i + 1);
+    m2048.limbs[i] = m.limbs[i % NLIMBS_512] ^ (i << 17);
+  }
+  m2048.limbs[0] |= 1;
+  m2048.limbs[u2048::LIMBS - 1] |= 1ULL << 63;
+  u2048 r2048;
+  check("u2048", "mulmod", u2048::expmod(a2048, 2, m2048) == u2048::mulmod(a2048, a2048, m2048));
+  run("u2048", "mulmod", 256, 2000, [&] { r2048 = u2048::mulmod(a2048, a2048, m2048); keep(r2048); });
+  run("u2048", "expmod_e65537", 256, 2, [&] { r2048 = u2048::expmod(a2048, 65537, m2048); keep(r2048); });
+
+  static const usize wide_limbs[] = {8, 16, 32, 64};
+  static u64 wsq[128];
+  u512 w0, w1, wlo, whi;
+  memcpy(w0.limbs, wa, 64);
+  memcpy(w1.limbs, wb, 64);
+  u512::mul_wide(w0, w1, wlo, whi);
+  intx::mul_wide(wr, wa, wb, 8);
+  check("intx", "mul_wide", bytes_equal((u8 *)wr, (u8 *)wlo.limbs, 64) && bytes_equal((u8 *)(wr + 8), (u8 *)whi.limbs, 64));
+  for (usize n : wide_limbs) {
+    intx::mul_wide(wr, wa, wa, n);
+    intx::sqr_wide(wsq, wa, n);
+    check("intx", "sqr_wide", bytes_equal((u8 *)wr, (u8 *)wsq, n * 16));
+  }
+  for (usize n : wide_limbs) {
+    run("intx", "mul_wide", n * 8, 20000, [&] { intx::mul_wide(wr, wa, wb, n); keep(wr); });
+    run("intx", "sqr_wide", n * 8, 20000, [&] { intx::sqr_wide(wr, wa, n); keep(wr); });
+  }
+}
+
+// Throwaway 2048-bit test key, e = 65537.
+static const char *rsa_n =
+  "e7b09c3543809c117e314055e81ceb3f19328fb625bdbf51a9f9689b26c2db79"
+  "4ff1a03f4d09d75f780a407543f1941bf09e172a389b938344cc5ad99436ce36"
+  "e30fc2b312c54b58cb49bd9b0b9cd52dc96110d25dd3a7c978b9a8738d05025c"
+  "50d5e72db7107ae4f3f40c4ab1dccf77fa89d059278c4a9cd188d6a94c7a6e30"
+  "9719c537480fb6aa1f89cebe1426cd4e001dfc3292987e4e18ff98e8626ad6c9"
+  "88452db0c7cce500f94c98e6b386de63ddd15d4b83ba9667df402472b9f48f28"
+  "623fbee83e48dac4d766091e9de26cd78cdfe5e618952ff4a7bf111a7b420069"
+  "979751591fba3185b4835c017e4235abd4cabad70d03fde81c66dd12d8cfeb0f";
+static const char *rsa_p =
+  "f87626d2e399d74158e367a6880a0158055aabc5bed6486cbee578554e7a0d95"
+  "7e3bf3c89cf957b239895d78adbace94a58d99803b3543d247ddfe1b00e16377"
+  "31db331a399b0fe52677813ed7a153ab49dd12c269d4dfb89c67690edb245891"
+  "f50372025b131bec06bab568afd9a1d59074e5a7d099362e8e1900efd79ebf51";
+static const char *rsa_q =
+  "eeb8309fda16636e75694d2ed68126ee61742b9ce049cf17f44b7c12e782e17e"
+  "0f24ea3925e55c8391f687821310023cddcb3705c62864851b7fd75d731a5d1a"
+  "eeb41a0b7406a4a61b07217c7151fc1dc03df437aa58115e69c7be5722607933"
+  "4c14f6a509967aa06f910076f310f9e252148a4c174ce152e5b062745c752c5f";
+static const char *rsa_dp =
+  "99b0a445512a895f4fb7a316fd118b5142469af8801a96c445b5362136a10324"
+  "14e8cadcae55026d29701214a30a69dcc3277aeb3a34b19632845c39a1eac997"
+  "228cdfe879f7b3f6603c0e03ac688b93e9e5c943df292196559116086d7fe715"
+  "aa048e926c79be8cda80c5d452ea8153d4beaa8c8ad92b0dd3321e453e106171";
+static const char *rsa_dq =
+  "36981126bdad9917cdea43288f0e02654a0c535d113e500a5e6854fbcdce74db"
+  "6b8339bdd018e04b86ba26cb6ca8a09a62eef2aa7363117a0f8bf1290205e97d"
+  "1b523d12997a5b75518113fb6dbf1e357f9dab987f709ca846f0d36b0205a632"
+  "41181a402c2d29e63f1d9e4995d53010be4ccc4412a01677eae7a7dc8cb88f69";
+static const char *rsa_qi =
+  "7d1f0f67eaf05cd80c4146160581c8e714874cdd8f2c0319a37f4b29e9d9ca68"
+  "fe3a92856be3a28bdcc7ab7a41475ce9fffa3c79322be36e1700879fb562a513"
+  "6feee19ddafc9f56296adfbb1c525ec378a38e666ab4bdc242811164c6238c4c"
+  "a92889ed59e810c46e7ccf98a37106cc4832f8ca2eb6337723860aadfc252c72";
+static const char *rsa_d =
+  "6226a7ee4a93ebc9df5757056da8fea1c2f76ff93ea0d5316fdbf84c2e0e0373"
+  "2f82519c2f733959b8dd42f44a9dc75c54c16c57d71655561969a71d20945d24"
+  "d4694356a05f936d60e572dd017ce5b49968b4fb21837e43b41096c3a8dc93e4"
+  "eedbc72d4f2dbc9a4c9cb92e558e1118273b85d79710f034e1f161dae3cac3ed"
+  "a45a0cace3dfd282373336cc264f7308b692582a7e5ea5d0b0ffeb215f7109e5"
+  "c68d3d128c78a994116974594302168fc722e5a3f07794e4c7ce961da151e796"
+  "b0ea622f061fc16a48ce784a215b90c82a6ee36f41e8b5a52781f38422766811"
+  "779118dbde3f09200893039eb930b1c82dfb2a11f311e91ed954a90d6abd37d1";
+
+static void fill_pattern(void *ctx, u8 *buf, usize len) {
+  u8 *seed = (u8 *)ctx;
+  for (usize i = 0; i < len; i++) {
+    buf[i] = ++*seed | 1;
+  }
+}
+
+static void bench_rsa() {
+  u2048 n = u2048::from_hex(rsa_n);
+  u2048 d = u2048::from_hex(rsa_d);
+  RSA::PrivateKey<32> key(n, 65537, u1024::from_hex(rsa_p), u1024::from_hex(rsa_q),
+                          u1024::from_hex(rsa_dp), u1024::from_hex(rsa_dq), u1024::from_hex(rsa_qi));
+  u8 seed = 0;
+  struct rsa_random rng = {fill_pattern, &seed};
+
+  u8 digest[SHA256_DIGEST_SIZE];
+  u8 sig[256];
+  u8 msg[256];
+  u8 pt[256];
+  usize pt_len;
+  static const u8 abc_digest[SHA256_DIGEST_SIZE] = {
+    0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+    0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+  };
+  sha256((const u8 *)"abc", 3, digest);
+  check("sha256", "4096", bytes_equal(digest, abc_digest, sizeof(digest)));
+  sha256(src_buf, 4096, digest);
+  memset(msg, 0x42, sizeof(msg));
+
+  u2048 x = u2048::from_hex(rsa_p) + 12345;
+  u2048 r = u2048::expmod(x, d, n);
+  check("rsa2048", "private_crt", key.apply(x) == r);
+  check("rsa2048", "public", key.pub.apply(r) == x);
+  check("rsa2048", "sign_pkcs1", RSA::sign_pkcs1(key, digest, sig));
+  check("rsa2048", "verify_pkcs1", RSA::verify_pkcs1(key.pub, digest, sig, sizeof(sig)));
+  sig[100] ^= 1;
+  check("rsa2048", "verify_pkcs1", !RSA::verify_pkcs1(key.pub, digest, sig, sizeof(sig)));
+  check("rsa2048", "sign_pss", RSA::sign_pss(key, digest, &rng, sig));
+  check("rsa2048", "verify_pss", RSA::verify_pss(key.pub, digest, sig, sizeof(sig)));
+  sig[100] ^= 1;
+  check("rsa2048", "verify_pss", !RSA::verify_pss(key.pub, digest, sig, sizeof(sig)));
+
+  run("sha256", "4096", 4096, 2000, [&] { sha256(src_buf, 4096, digest); keep(digest); });
+  run("rsa2048", "expmod_d", 256, 2, [&] { r = u2048::expmod(x, d, n); keep(r); });
+  run("rsa2048", "private_crt", 256, 2, [&] { r = key.apply(x); keep(r); });
+  run("rsa2048", "public", 256, 20, [&] { r = key.pub.apply(x); keep(r); });
+  run("rsa2048", "sign_pkcs1", 256, 2, [&] { RSA::sign_pkcs1(key, digest, sig); keep(sig); });
+  run("rsa2048", "verify_pkcs1", 256, 20, [&] { keep(RSA::verify_pkcs1(key.pub, digest, sig, sizeof(sig))); });
+  run("rsa2048", "sign_pss", 256, 2, [&] { RSA::sign_pss(key, digest, &rng, sig); keep(sig); });
+  run("rsa2048", "verify_pss", 256, 20, [&] { keep(RSA::verify_pss(key.pub, digest, sig, sizeof(sig))); });
+
+  RSA::encrypt_pkcs1(key.pub, msg, 32, &rng, sig);
+  check("rsa2048", "decrypt_pkcs1",
+        RSA::decrypt_pkcs1(key, sig, sizeof(sig), pt, sizeof(pt), &pt_len) && pt_len == 32 && bytes_equal(pt, msg, 32));
+  run("rsa2048", "decrypt_pkcs1", 256, 2, [&] { keep(RSA::decrypt_pkcs1(key, sig, sizeof(sig), pt, sizeof(pt), &pt_len)); });
+}
+
+static u8 *read_file(const char *path, usize *size) {
+  int fd = open(path, 0);
+  if (fd < 0) return nullptr;
+  usize cap = 1 << 20;
+  usize len = 0;
+  u8 *data = (u8 *)malloc(cap);
+  for (;;) {
+    if (len == cap) {
+      u8 *grown = (u8 *)malloc(cap * 2);
+      memcpy(grown, data, len);
+      data = grown;
+      cap *= 2;
+    }
+    long n = read(fd, data + len, cap - len);
+    if (n <= 0) break;
+    len += n;
+  }
+  close(fd);
+  *size = len;
+  return data;
+}
+
+// Stripped images have no symtab, and the symbol cases then run empty.
+static usize symtab_count(struct elf_desc *desc) {
+  return desc->sects.symtab ? desc->sects.symtab->sh_size / sizeof(struct elf_sym) : 0;
+}
+
+// Any defined function symbol with debug info will do; main always exists.
+static u64 find_symbol(struct elf_desc *desc, const char *name) {
+  usize count = symtab_count(desc);
+  for (usize i = 0; i < count; i++) {
+    if (strcmp(desc->strtab + desc->symtab[i].st_name, name) == 0) {
+      return desc->symtab[i].st_value;
+    }
+  }
+  return 0;
+}
+
+// The linear scan the symbolizer replaces: the covering function or object
+// symbol, found by visiting every entry.
+static const char *scan_symbol(struct elf_desc *desc, u64 addr) {
+  usize count = symtab_count(desc);
+  for (usize i = 0; i < count; i++) {
+    struct elf_sym *s = &desc->symtab[i];
+    u8 type = ELF64_ST_TYPE(s->st_info);
+    if ((type == STT_FUNC || type == STT_OBJECT) && s->st_shndx != 0
+    && addr - s->st_value < s->st_size) {
+      return desc->strtab + s->st_name;
+    }
+  }
+  return nullptr;
+}
+
+#define SYM_PCS 1024
+
+static void bench_elf(const char *path) {
+  usize size = 0;
+  u8 *data = read_file(path, &size);
+  if (!data) {
+    out("# cannot read %s, skipping elf benchmarks\n", path);
+    return;
+  }
+
+  struct elf_desc desc = {};
+  run("elf", "parse", size, 2000, [&] {
+    desc = {};
+    elf_parse(&desc, data, size);
+    keep(desc);
+    elf_free(&desc);
+  });
+  elf_parse(&desc, data, size);
+
+  // Load every PT_LOAD segment into one zeroed span, copying everything or
+  // only what a mapping loader would have to.
+  static struct elf_segment_plan plans[16];
+  usize nplans = elf_load_plan(&desc, plans, 16);
+  if (nplans > 16) nplans = 16;
+  run("elf", "load_plan", nplans, 20000, [&] { keep(elf_load_plan(&desc, plans, 16)); });
+  if (nplans) {
+    u64 lo = plans[0].vaddr;
+    u64 hi = plans[nplans - 1].vaddr + plans[nplans - 1].size;
+    u8 *image = (u8 *)malloc(hi - lo);
+    memset(image, 0, hi - lo);
+    for (usize i = 0; i < nplans; i++) elf_load_segment(&desc, &plans[i], image + (plans[i].vaddr - lo), true);
+    for (usize i = 0; i < desc.header->e_phnum; i++) {
+      struct elf_phdr *ph = &desc.phdrs[i];
+      if (ph->p_type != PT_LOAD) continue;
+      u8 *seg = image + (ph->p_vaddr - lo);
+      check("elf", "load_copy", bytes_equal(seg, data + ph->p_offset, ph->p_filesz)
+            && bytes_all(seg + ph->p_filesz, 0, ph->p_memsz - ph->p_filesz));
+    }
+    run("elf", "load_copy", hi - lo, 200, [&] {
+      for (usize i = 0; i < nplans; i++) elf_load_segment(&desc, &plans[i], image + (plans[i].vaddr - lo), true);
+      keep(image[0]);
+    });
+    run("elf", "load", hi - lo, 200, [&] {
+      for (usize i = 0; i < nplans; i++) elf_load_segment(&desc, &plans[i], image + (plans[i].vaddr - lo), false);
+      keep(image[0]);
+    });
+  }
+
+  run("elf", "find_section", desc.shnum, 20000, [&] { keep(elf_find_section(&desc, ".debug_line")); });
+  check("elf", "find_section_type", elf_find_section_type(&desc, SHT_SYMTAB) == desc.sects.symtab
+        && elf_find_section_type(&desc, SHT_GNU_HASH) == desc.sects.gnu_hash);
+
+  // a symtab or section name pointing past the image is dropped, not read
+  if (desc.sects.symtab) {
+    u8 *bad = (u8 *)malloc(size);
+    memcpy(bad, data, size);
+    struct elf_desc bad_desc = {};
+    struct elf_shdr *shdrs = (struct elf_shdr *)(bad + desc.header->e_shoff);
+    usize symtab = desc.sects.symtab - desc.shdrs;
+    shdrs[symtab].sh_offset = size;
+    shdrs[symtab].sh_name = 0xffffffff;
+    elf_parse(&bad_desc, bad, size);
+    check("elf", "bad_symtab", !bad_desc.symtab && !elf_find_section(&bad_desc, ".symtab")
+          && elf_find_section_type(&bad_desc, SHT_SYMTAB) == &shdrs[symtab]);
+    elf_free(&bad_desc);
+  }
+
+  u64 addr = find_symbol(&desc, "main");
+  if (desc.debug.debug_line) check("dwarf", "addr2line", DWARF::addr2line_lookup(&desc, addr).found);
+  run("dwarf", "addr2line", size, 20, [&] {
+    Addr2LineResult res = DWARF::addr2line_lookup(&desc, addr);
+    keep(res);
+  });
+
+  // PCs in the middle of functions spread over the whole table, repeated to
+  // fill the ring
+  static u64 pcs[SYM_PCS];
+  static u64 starts[SYM_PCS];
+  usize nsyms = symtab_count(&desc);
+  usize stride = nsyms / SYM_PCS + 1;
+  usize npcs = 0;
+  for (usize i = 0; i < nsyms && npcs < SYM_PCS; i += stride) {
+    struct elf_sym *s = &desc.symtab[i];
+    if (ELF64_ST_TYPE(s->st_info) == STT_FUNC && s->st_shndx != 0 && s->st_size) {
+      starts[npcs] = s->st_value;
+      pcs[npcs++] = s->st_value + s->st_size / 2;
+    }
+  }
+  for (usize i = npcs; npcs && i < SYM_PCS; i++) {
+    pcs[i] = pcs[i % npcs];
+  }
+
+  struct elf_symbolizer sym;
+  run("elf", "symbolizer_init", nsyms, 20, [&] {
+    elf_symbolizer_init(&sym, &desc);
+    elf_symbolizer_free(&sym);
+  });
+  elf_symbolizer_init(&sym, &desc);
+  for (usize i = 0; i < npcs; i++) {
+    u64 off;
+    check("elf", "symbolize", elf_symbolize(&sym, pcs[i], &off) && pcs[i] - off == starts[i]);
+  }
+  usize pc = 0;
+  run("elf", "symbolize_scan", nsyms, 200, [&] { keep(scan_symbol(&desc, pcs[pc++ % SYM_PCS])); });
+  run("elf", "symbolize", nsyms, 20000, [&] {
+    u64 off;
+    keep(elf_symbolize(&sym, pcs[pc++ % SYM_PCS], &off));
+  });
+  elf_symbolizer_free(&sym);
+
+  // Names of the same spread of symbols; dynamic ones only if the image
+  // has a .gnu.hash or .hash to find them through.
+  static const char *names[SYM_PCS];
+  static const char *dyn_names[SYM_PCS];
+  usize nnames = 0;
+  for (usize i = 0; i < nsyms && nnames < SYM_PCS; i += stride) {
+    struct elf_sym *s = &desc.symtab[i];
+    if (s->st_name && s->st_shndx != 0) names[nnames++] = desc.strtab + s->st_name;
+  }
+  usize ndyn = 0;
+  if (desc.dynsym && (desc.sects.gnu_hash || desc.sects.hash)) {
+    usize count = desc.sects.dynsym->sh_size / sizeof(struct elf_sym);
+    for (usize i = 0; i < count && ndyn < SYM_PCS; i++) {
+      struct elf_sym *s = &desc.dynsym[i];
+      if (s->st_name && s->st_shndx != 0) dyn_names[ndyn++] = desc.dynstr + s->st_name;
+    }
+  }
+
+  usize ni = 0;
+  if (nnames) {
+    run("elf", "find_symbol_scan", nsyms, 200, [&] { keep(find_symbol(&desc, names[ni++ % nnames])); });
+  }
+  if (ndyn) {
+    // without symtab names the lookup goes through the image's hash table
+    struct elf_desc dyn = desc;
+    dyn.symtab = nullptr;
+    dyn.sects.symtab = nullptr;
+    dyn.names = {};
+    for (usize i = 0; i < ndyn; i++) {
+      const struct elf_sym *s = elf_find_symbol(&dyn, dyn_names[i]);
+      check("elf", "find_symbol_dynamic", s && strcmp(desc.dynstr + s->st_name, dyn_names[i]) == 0);
+    }
+    run("elf", "find_symbol_dynamic", ndyn, 20000, [&] { keep(elf_find_symbol(&dyn, dyn_names[ni++ % ndyn])); });
+  }
+  run("elf", "index_names", nsyms, 20, [&] {
+    elf_free_names(&desc);
+    elf_index_names(&desc);
+  });
+  for (usize i = 0; i < nnames; i++) {
+    const struct elf_sym *s = elf_find_symbol(&desc, names[i]);
+    check("elf", "find_symbol", s && strcmp(desc.strtab + s->st_name, names[i]) == 0);
+  }
+  if (nnames) {
+    run("elf", "find_symbol", nsyms, 20000, [&] { keep(elf_find_symbol(&desc, names[ni++ % nnames])); });
+  }
+  elf_free(&desc);
+}
+
+// Every external resolves to some address in the first 16 MiB, so all of
+// the object's 32-bit fields fit.
+static u64 bench_resolve(void *ctx, const char *name) {
+  (*(usize *)ctx)++;
+  return 0x1000000 - 64 * (strlen(name) + 1);
+}
+
+// Links a relocatable object into a heap arena, every section included so
+// the debug info's relocations count too, at made-up low addresses.
+static void bench_module(const char *path) {
+  usize size = 0;
+  u8 *data = read_file(path, &size);
+  if (!data) {
+    out("# cannot read %s, skipping module benchmarks\n", path);
+    return;
+  }
+
+  struct elf_desc desc = {};
+  elf_parse(&desc, data, size);
+  struct elf_placement *place = (struct elf_placement *)malloc(desc.shnum * sizeof(struct elf_placement));
+  memset(place, 0, desc.shnum * sizeof(struct elf_placement));
+  usize span = 0;
+  usize nrelocs = 0;
+  for (usize i = 1; i < desc.shnum; i++) {
+    if (desc.shdrs[i].sh_type == SHT_RELA) nrelocs += desc.shdrs[i].sh_size / sizeof(struct elf_rela);
+    span += (desc.shdrs[i].sh_size + 15) & ~15UL;
+  }
+  u8 *arena = (u8 *)malloc(span);
+  usize at = 0;
+  for (usize i = 1; i < desc.shnum; i++) {
+    struct elf_shdr *shdr = &desc.shdrs[i];
+    if (shdr->sh_type == SHT_RELA || shdr->sh_type == SHT_SYMTAB || shdr->sh_type == SHT_STRTAB) continue;
+    place[i].addr = 0x100000 + at;
+    place[i].mem = arena + at;
+    if (shdr->sh_type == SHT_NOBITS) {
+      memset(arena + at, 0, shdr->sh_size);
+    } else {
+      memcpy(arena + at, data + shdr->sh_offset, shdr->sh_size);
+    }
+    at += (shdr->sh_size + 15) & ~15UL;
+  }
+
+  static u64 got[256];
+  usize lookups = 0;
+  struct elf_resolver resolver = {bench_resolve, &lookups};
+  struct elf_placement got_place = {0x100000 + at, got};
+  int status = 0;
+  auto link = [&] {
+    struct elf_module mod;
+    enum elf_reloc_status st = elf_module_init(&mod, &desc, place, &resolver, got_place, 256);
+    if (st != ELF_RELOC_OK) return st;
+    u32 missing[1];
+    keep(elf_module_resolve(&mod, missing, 1));
+    st = elf_module_relocate(&mod);
+    elf_module_free(&mod);
+    return st;
+  };
+  run("elf", "module_link", nrelocs, 20, [&] { status |= link(); });
+  check("elf", "module_link", status == ELF_RELOC_OK);
+
+  // A malformed module is refused, not followed off the end of its tables:
+  // first a symbol index past symtab, then a RELA section past the image.
+  struct elf_shdr *rela_shdr = nullptr;
+  for (usize i = 1; i < desc.shnum && !rela_shdr; i++) {
+    struct elf_shdr *shdr = &desc.shdrs[i];
+    if (shdr->sh_type == SHT_RELA && shdr->sh_size && place[shdr->sh_info].addr) rela_shdr = shdr;
+  }
+  if (rela_shdr) {
+    struct elf_rela *rela = (struct elf_rela *)(data + rela_shdr->sh_offset);
+    u64 info = rela->r_info;
+    rela->r_info = (u64)0x7fffffff << 32 | ELF64_R_TYPE(info);
+    check("elf", "module_bad_symbol", link() == ELF_RELOC_BAD_SYMBOL);
+    rela->r_info = info;
+    u64 offset = rela_shdr->sh_offset;
+    rela_shdr->sh_offset = size - 8;
+    check("elf", "module_bad_rela", link() == ELF_RELOC_BAD_IMAGE);
+    rela_shdr->sh_offset = offset;
+  }
+  elf_free(&desc);
+}
+
+int main(int argc, char **argv) {
+  dst_buf = (u8 *)malloc(BUF_SIZE + 64);
+  src_buf = (u8 *)malloc(BUF_SIZE + 64);
+  memset(src_buf, 0x11, BUF_SIZE + 64);
+  memset(dst_buf, 0x22, BUF_SIZE + 64);
+
+  const struct string_dispatch *d = string_dispatch_init();
+  out("# dispatch memcpy=%s memset=%s memmove=%s memcmp=%s strlen=%s\n",
+      d->memcpy, d->memset, d->memmove, d->memcmp, d->strlen);
+  out("group,case,param,iters,cycles_per_op\n");
+  bench_memory();
+  bench_strings();
+  bench_vformat();
+  bench_intx();
+  bench_rsa();
+  bench_elf(argc > 1 ? argv[1] : "/proc/self/exe");
+  bench_module(argc > 2 ? argv[2] : "build/bench/klib/intx.o");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,29 @@
+#include <klib/types.h>
+#include <klib/string.h>
+
+// Hosted stand-ins for the symbols the kernel normally provides to klib.
+
+extern "C" {
+void *malloc(usize size);
+void free(void *ptr);
+long write(int fd, const void *buf, usize count);
+[[noreturn]] void abort();
+}
+
+void *kmalloc(usize size) {
+  return malloc(size);
+}
+
+void kfree(void *ptr) {
+  free(ptr);
+}
+
+namespace Log {
+  void __failed_assert(const char *assertion, const char *message, const char *file, u32 line, const char *function) {
+    char buf[512];
+    usize n = snprintf(buf, sizeof(buf), "assertion failed: %s (%s) at %s:%u in %s\n",
+                       assertion, message, file, line, function);
+    write(2, buf, n < sizeof(buf) ? n : sizeof(buf) - 1);
+    abort();
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <klib/types.h>
+
+// CPU features klib picks code paths on. Probed once via CPUID.
+struct cpu_features {
+  bool erms;  // enhanced rep movsb/stosb
+  bool fsrm;  // fast short rep movsb
+  bool bmi1;  // tzcnt, andn
+  bool bmi2;  // mulx, shlx/shrx
+  bool adx;   // adcx, adox
+};
+
+const struct cpu_features *cpu_get_features();
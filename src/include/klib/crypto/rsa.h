@@ -0,0 +1,77 @@
+#pragma once
+#include <klib/types.h>
+#include <klib/intx.h>
+#include <klib/crypto/sha256.h>
+
+// Source of random bytes for padding and salts. fill() must write len
+// unpredictable bytes to buf.
+struct rsa_random {
+  void (*fill)(void *ctx, u8 *buf, usize len);
+  void *ctx;
+};
+
+// RSA over moduli of up to 64 * Limbs bits (instantiated for 1024, 2048 and
+// 4096). Signatures and ciphertexts are big-endian byte strings exactly
+// size() bytes long; digests are SHA-256. Keys precompute their Montgomery
+// contexts, so build them once and reuse them.
+namespace RSA {
+  template<usize Limbs>
+  class PublicKey {
+  public:
+    typedef uint_t<Limbs> value_type;
+
+    Montgomery<Limbs> mont;
+    value_type e;
+    usize bits;
+
+    PublicKey(const value_type& n, const value_type& e);
+
+    // Modulus length in bytes.
+    usize size() const { return (bits + 7) / 8; }
+    // x^e mod n; x must be below n.
+    value_type apply(const value_type& x) const;
+  };
+
+  // Private key in PKCS#1 CRT form: p and q are the half-width prime
+  // factors, dp = d mod (p - 1), dq = d mod (q - 1), qinv = q^-1 mod p.
+  template<usize Limbs>
+  class PrivateKey {
+  public:
+    typedef uint_t<Limbs> value_type;
+    typedef uint_t<Limbs / 2> half_type;
+
+    PublicKey<Limbs> pub;
+    Montgomery<Limbs / 2> mont_p;
+    Montgomery<Limbs / 2> mont_q;
+    half_type dp;
+    half_type dq;
+    half_type qinv;
+
+    PrivateKey(const value_type& n, const value_type& e, const half_type& p, const half_type& q,
+               const half_type& dp, const half_type& dq, const half_type& qinv);
+
+    usize size() const { return pub.size(); }
+    // x^d mod n via two half-width exponentiations and Garner recombination.
+    value_type apply(const value_type& x) const;
+  };
+
+  // PKCS#1 v1.5 signatures (EMSA-PKCS1-v1_5 with a SHA-256 DigestInfo).
+  template<usize Limbs>
+  bool verify_pkcs1(const PublicKey<Limbs>& key, const u8 *digest, const u8 *sig, usize sig_len);
+  template<usize Limbs>
+  bool sign_pkcs1(const PrivateKey<Limbs>& key, const u8 *digest, u8 *sig);
+
+  // PSS signatures with MGF1-SHA-256. verify accepts any salt length; sign
+  // uses a salt as long as the digest.
+  template<usize Limbs>
+  bool verify_pss(const PublicKey<Limbs>& key, const u8 *digest, const u8 *sig, usize sig_len);
+  template<usize Limbs>
+  bool sign_pss(const PrivateKey<Limbs>& key, const u8 *digest, const struct rsa_random *rng, u8 *sig);
+
+  // PKCS#1 v1.5 encryption of at most size() - 11 bytes.
+  template<usize Limbs>
+  bool encrypt_pkcs1(const PublicKey<Limbs>& key, const u8 *msg, usize len, const struct rsa_random *rng, u8 *out);
+  // Writes the plaintext to out (room for cap bytes) and its length to len.
+  template<usize Limbs>
+  bool decrypt_pkcs1(const PrivateKey<Limbs>& key, const u8 *in, usize in_len, u8 *out, usize cap, usize *len);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <klib/types.h>
+
+#define SHA256_DIGEST_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+// Incremental SHA-256 (FIPS 180-4). init, update any number of times, final.
+struct sha256_ctx {
+  u32 state[8];
+  u64 len;
+  u8 buf[SHA256_BLOCK_SIZE];
+  usize buf_len;
+};
+
+void sha256_init(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, const void *data, usize len);
+void sha256_final(struct sha256_ctx *ctx, u8 *digest);
+
+// One-shot digest of len bytes at data.
+void sha256(const void *data, usize len, u8 *digest);
@@ -61,6 +61,12 @@ struct elf_sym {
   u64 st_size;
 };
 
+struct elf_rela {
+  u64 r_offset;
+  u64 r_info;
+  s64 r_addend;
+};
+
 struct elf_dyn {
   u64 d_tag;
   union {
@@ -69,6 +75,26 @@ struct elf_dyn {
   } d_un;
 };
 
+enum elf_reltype {
+  R_X86_64_NONE = 0,
+  R_X86_64_64 = 1,
+  R_X86_64_PC32 = 2,
+  R_X86_64_GOT32 = 3,
+  R_X86_64_PLT32 = 4,
+  R_X86_64_GOTPCREL = 9,
+  R_X86_64_32 = 10,
+  R_X86_64_32S = 11,
+  R_X86_64_16 = 12,
+  R_X86_64_PC16 = 13,
+  R_X86_64_8 = 14,
+  R_X86_64_PC8 = 15,
+  R_X86_64_PC64 = 24,
+  R_X86_64_GOTOFF64 = 25,
+  R_X86_64_GOTPC32 = 26,
+  R_X86_64_GOTPCRELX = 41,
+  R_X86_64_REX_GOTPCRELX = 42
+};
+
 enum elf_type {
   ET_NONE = 0,
   ET_REL = 1,
@@ -91,6 +117,12 @@ enum elf_ptype {
   PT_HIPROC = 0x7fffffff
 };
 
+enum elf_pflags {
+  PF_X = 0x1,
+  PF_W = 0x2,
+  PF_R = 0x4
+};
+
 enum elf_stype {
   SHT_NULL = 0,
   SHT_PROGBITS = 1,
@@ -104,12 +136,23 @@ enum elf_stype {
   SHT_REL = 9,
   SHT_SHLIB = 10,
   SHT_DYNSYM = 11,
+  SHT_GNU_HASH = 0x6ffffff6,
   SHT_LOPROC = 0x70000000,
   SHT_HIPROC = 0x7fffffff,
   SHT_LOUSER = 0x80000000,
   SHT_HIUSER = 0xffffffff
 };
 
+// Reserved section indices. SHN_XINDEX in e_shstrndx means the real index
+// is in section 0's sh_link.
+enum elf_shn {
+  SHN_UNDEF = 0,
+  SHN_LORESERVE = 0xff00,
+  SHN_ABS = 0xfff1,
+  SHN_COMMON = 0xfff2,
+  SHN_XINDEX = 0xffff
+};
+
 enum elf_shtype {
   STB_LOCAL = 0,
   STB_GLOBAL = 1,
@@ -145,16 +188,51 @@ enum elf_shflags {
   SHF_EXCLUDE = 0x8000000
 };
 
+// One slot of an open-addressing name table: the name's GNU hash and 1 +
+// the index of the entry it names, 0 when the slot is empty.
+struct elf_name_slot {
+  u32 hash;
+  u32 index;
+};
+
+struct elf_name_table {
+  struct elf_name_slot *slots;
+  u32 mask;
+};
+
+// Section types below this get a direct slot in elf_desc::by_type.
+#define ELF_SHT_INDEXED (SHT_DYNSYM + 1)
+
+// A parsed image. It points into the image and also owns heap memory, the
+// section and symbol name tables elf_parse allocates: every desc that
+// elf_parse filled must be released with elf_free.
 struct elf_desc {
   struct elf_header *header;
   struct elf_phdr *phdrs;
   struct elf_shdr *shdrs;
+  // Section count, read from section 0 when e_shnum overflows.
+  usize shnum;
+  // Null when the image has no such table, a stripped one having no symtab,
+  // or when it or its string table lies outside the image.
   struct elf_sym *symtab;
-  
+  struct elf_sym *dynsym;
+  const char *dynstr;
+
   struct common_sects {
     struct elf_shdr *symtab;
+    struct elf_shdr *dynsym;
+    struct elf_shdr *gnu_hash;
+    struct elf_shdr *hash;
   } sects;
 
+  // Index of the first section of each type below ELF_SHT_INDEXED, 0 when
+  // there is none.
+  u32 by_type[ELF_SHT_INDEXED];
+  // Section names, indexed by elf_parse and released by elf_free.
+  struct elf_name_table sections;
+  // Symtab names, also indexed by elf_parse and released by elf_free.
+  struct elf_name_table names;
+
   struct debug_sects {
     struct elf_shdr *debug_info;
     struct elf_shdr *debug_abbrev;
@@ -169,10 +247,171 @@ struct elf_desc {
   struct elf_shdr *shstrtab_shdr;
 
   void *raw_ptr;
+  usize size;
 };
 
 #define ELF64_ST_BIND(i) ((i) >> 4)
 #define ELF64_ST_TYPE(i) ((i) & 0xf)
+#define ELF64_R_SYM(i) ((i) >> 32)
+#define ELF64_R_TYPE(i) ((i) & 0xffffffff)
 
+// Indexes the sections of the image at data by type and by name in one pass
+// over the section headers, then the names of its symbols. Both name tables
+// are allocated with kmalloc and belong to desc: call elf_free before desc
+// goes away or is parsed into again, as elf_parse takes desc to be
+// uninitialised and would leak them.
 void elf_parse(struct elf_desc *desc, void *data, usize size);
+// Frees the section and symbol name tables.
+void elf_free(struct elf_desc *desc);
+// Section called name, or null; one hash probe.
+struct elf_shdr *elf_find_section(const struct elf_desc *desc, const char *name);
+// First section of type, or null. One load for the types below
+// ELF_SHT_INDEXED; the rarer OS and processor types are found by a walk of
+// the section headers.
+struct elf_shdr *elf_find_section_type(const struct elf_desc *desc, u32 type);
+// Whether shdr's contents lie inside the image; SHT_NOBITS sections have
+// none and always do.
+bool elf_section_in_image(const struct elf_desc *desc, const struct elf_shdr *shdr);
+// Contents of shdr in the image, or null for SHT_NOBITS sections.
+void *elf_section_data(const struct elf_desc *desc, const struct elf_shdr *shdr);
+// The .gnu.hash function, which every name table here uses.
+u32 elf_gnu_hash(const char *name);
+
+// Builds the symbol name index over every named, defined symtab entry; a
+// global definition wins over local and weak ones of the same name.
+// elf_parse and elf_free already call these.
+void elf_index_names(struct elf_desc *desc);
+void elf_free_names(struct elf_desc *desc);
+// Defined symbol called name, or null: one probe of the name index. An image
+// without symtab, stripped say, has an empty index, and its own .gnu.hash or
+// .hash is searched instead; those cover only the dynamic symbols.
+const struct elf_sym *elf_find_symbol(const struct elf_desc *desc, const char *name);
+
+// One STT_FUNC or STT_OBJECT symbol: its address range and the offset of
+// its name in the string table.
+struct elf_symbol {
+  u64 start;
+  u32 size;
+  u32 name;
+};
+
+// Address-to-symbol index over a parsed image. The symbols are stored in
+// Eytzinger (breadth-first) order, 1-based, so a lookup walks the array
+// from the front and the next two levels it reads share a cache line.
+struct elf_symbolizer {
+  struct elf_symbol *syms;
+  usize count;
+  const char *strtab;
+};
+
+// Builds the index from desc's symbol table. Symbols without a size extend
+// to the next symbol; of several at one address the largest is kept.
+void elf_symbolizer_init(struct elf_symbolizer *sym, const struct elf_desc *desc);
+void elf_symbolizer_free(struct elf_symbolizer *sym);
+// Name of the symbol covering addr, with addr's offset into it stored in
+// *offset (which may be null). Returns null when no symbol covers addr.
+const char *elf_symbolize(const struct elf_symbolizer *sym, u64 addr, u64 *offset);
+
+// Granule of the mapping plans; the kernel's page size.
+#define ELF_PAGE_SIZE 0x1000
+
+// A run of file bytes placed at a virtual address.
+struct elf_run {
+  u64 vaddr;
+  u64 offset;
+  u64 size;
+};
+
+// How to load one PT_LOAD segment. Addresses are the link-time ones; add
+// the load bias for ET_DYN images. The segment occupies the whole pages
+// [vaddr, vaddr + size), which start out zeroed except for the mapped run:
+//  - map: whole file pages the caller maps in place, page-aligned on both
+//    sides, or size 0 when p_offset and p_vaddr disagree modulo the page;
+//  - copy: the partial pages around it, or all file bytes when nothing is
+//    mapped;
+//  - zero: .bss, the memory past the file bytes.
+// Neighbouring segments may share a partial page, which is never mapped.
+struct elf_segment_plan {
+  u64 vaddr;
+  u64 size;
+  u32 flags;
+  struct elf_run map;
+  struct elf_run copy[2];
+  u64 zero_vaddr;
+  u64 zero_size;
+};
+
+// Plans for desc's PT_LOAD segments, at most cap of them written to plans
+// in program header order. Returns the total count.
+usize elf_load_plan(const struct elf_desc *desc, struct elf_segment_plan *plans, usize cap);
+// Fills the segment's memory at dest, which corresponds to plan->vaddr:
+// copies the copy runs, clears .bss, and copies the mapped run too when
+// copy_mapped is set (for callers that cannot map). Bytes of the pages
+// outside the segment are left alone.
+void elf_load_segment(const struct elf_desc *desc, const struct elf_segment_plan *plan, void *dest, bool copy_mapped);
+
+// Resolves an undefined symbol of a module by name; returns its address, or
+// 0 when it is unknown.
+struct elf_resolver {
+  u64 (*resolve)(void *ctx, const char *name);
+  void *ctx;
+};
+
+// Where one section of a relocatable image lives: addr is the address its
+// code runs at, mem where its bytes can be written now (often the same).
+// addr 0 means the section is not loaded.
+struct elf_placement {
+  u64 addr;
+  void *mem;
+};
+
+enum elf_reloc_status {
+  ELF_RELOC_OK,
+  ELF_RELOC_UNRESOLVED,  // a symbol did not resolve; see elf_module_resolve
+  ELF_RELOC_UNSUPPORTED, // unknown relocation type
+  ELF_RELOC_OVERFLOW,    // a value does not fit its field
+  ELF_RELOC_BAD_OFFSET,  // a field lies outside its section
+  ELF_RELOC_GOT_FULL,    // more GOT entries needed than got_cap
+  ELF_RELOC_BAD_SYMBOL,  // a relocation names a symbol past the end of symtab
+  ELF_RELOC_BAD_IMAGE,   // not ET_REL, no usable symtab, or a RELA section lies outside the image
+  ELF_RELOC_NO_MEMORY    // the symbol cache could not be allocated
+};
+
+// Per-symbol memo: the address once resolved and, for symbols reached
+// through the GOT, 1 + their slot.
+struct elf_module_sym {
+  u64 addr;
+  u32 got;
+  u8 state;
+};
+
+// An ET_REL image being linked into memory. The symbol cache lives as long
+// as the module, so each symbol is looked up once however many relocations
+// use it. GOT-relative relocations get their slots from got, which must be
+// within 2 GiB of the code.
+struct elf_module {
+  const struct elf_desc *desc;
+  const struct elf_placement *place; // desc->shnum entries
+  struct elf_resolver resolver;
+  struct elf_module_sym *syms;
+  usize nsyms;
+  struct elf_placement got;
+  usize got_cap;
+  usize got_used;
+};
 
+// Checks that desc is a relocatable image with a symtab and sets up the
+// symbol cache. The module is only usable, and only needs
+// elf_module_free, when this returns ELF_RELOC_OK.
+enum elf_reloc_status elf_module_init(struct elf_module *mod, const struct elf_desc *desc,
+                                      const struct elf_placement *place, const struct elf_resolver *resolver,
+                                      struct elf_placement got, usize got_cap);
+void elf_module_free(struct elf_module *mod);
+// Resolves every symbol used by a relocation of a loaded section and
+// returns how many did not resolve; the first cap of their symtab indices
+// go to unresolved. Undefined weak symbols resolve to 0; SHN_COMMON ones
+// and those in unloaded sections never resolve.
+usize elf_module_resolve(struct elf_module *mod, u32 *unresolved, usize cap);
+// Applies the relocations of every loaded section, each RELA section in
+// one sequential pass. Stops at the first relocation that fails.
+enum elf_reloc_status elf_module_relocate(struct elf_module *mod);
@@ -0,0 +1,305 @@
+#pragma once
+#include <stdarg.h>
+#include <klib/types.h>
+#include <klib/traits.h>
+#include <klib/string.h>
+
+template<usize Limbs> class uint_t;
+typedef uint_t<8> u512;
+
+// Streaming output target for the formatter. write() receives the formatted
+// text in order, in chunks of arbitrary size; chunks are not NUL-terminated.
+struct fmt_sink {
+  void (*write)(void *ctx, const char *data, usize len);
+  void *ctx;
+};
+
+// Output cursor for the formatter. Bytes collect in buf; when it fills up
+// they are handed to the sink, or dropped (but still counted) when writing to
+// a fixed buffer. flushed + len is always the length produced so far.
+struct fmt_buf {
+  char *buf;
+  usize cap;
+  usize len;
+  usize flushed;
+  const struct fmt_sink *sink;
+};
+
+// Batch size for streaming output; big enough that per-call sink overhead
+// is amortised, small enough to live on the stack of any caller.
+#define FMT_CHUNK 128
+
+// One parsed %[#][0][width][l|ll][q]conv conversion.
+struct fmt_spec {
+  char conv;
+  bool alt;
+  bool zero_pad;
+  bool is_long;
+  bool quad;
+  int width;
+};
+
+// Parses the conversion following a '%' and returns a pointer to its
+// conversion character. Shared by the runtime and compile-time formatters.
+constexpr const char *fmt_parse_spec(const char *f, struct fmt_spec *spec) {
+  spec->alt = false;
+  spec->zero_pad = false;
+  spec->is_long = false;
+  spec->quad = false;
+  spec->width = 0;
+  if (*f == '#') { spec->alt = true; f++; }
+  if (*f == '0') { spec->zero_pad = true; f++; }
+  while (*f >= '0' && *f <= '9') {
+    spec->width = spec->width * 10 + (*f - '0');
+    f++;
+  }
+  if (*f == 'l') {
+    spec->is_long = true;
+    f++;
+    if (*f == 'l') {
+      f++;
+    }
+  }
+  if (*f == 'q') { spec->quad = true; f++; }
+  spec->conv = *f;
+  return f;
+}
+
+void fmt_put(struct fmt_buf *out, const char *s, usize n);
+void fmt_flush(struct fmt_buf *out);
+void fmt_put_int(struct fmt_buf *out, u64 mag, bool neg, const struct fmt_spec *spec);
+void fmt_put_uint(struct fmt_buf *out, const u64 *limbs, usize n, const struct fmt_spec *spec);
+void fmt_put_str(struct fmt_buf *out, const char *s, usize n, const struct fmt_spec *spec);
+void fmt_put_cstr(struct fmt_buf *out, const char *s, const struct fmt_spec *spec);
+
+// Format straight into a sink, batching small pieces so the sink is called
+// once per chunk rather than once per conversion. Returns the total length.
+usize vformat_to(struct fmt_sink sink, const char *format, va_list args);
+usize format_to(struct fmt_sink sink, const char *format, ...);
+
+template<typename F>
+struct fmt_sink fmt_make_sink(F& fn) {
+  return {
+    [](void *ctx, const char *data, usize len) { (*(F*)ctx)(data, len); },
+    (void *)&fn
+  };
+}
+
+// Functor form: fn(const char *data, usize len) is called for each chunk.
+template<typename F>
+usize vformat_to(F&& fn, const char *format, va_list args) {
+  return vformat_to(fmt_make_sink(fn), format, args);
+}
+
+template<typename F>
+usize format_to(F&& fn, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  usize len = vformat_to(fn, format, args);
+  va_end(args);
+  return len;
+}
+
+// Compile-time formatting. KFMT("...") wraps a literal in a unique type so
+// kformat can parse it during compilation into a fixed list of literal runs
+// and conversions, and check each argument against its conversion:
+//
+//   kformat(buf, sizeof(buf), KFMT("%s: %#x\n"), name, value);
+//
+// Length modifiers are accepted but unnecessary since the argument type
+// already carries its width. %qx, %qd and %qu take any uint_t width, %s a
+// C string or str_view.
+#define KFMT(s) ([] { struct kfmt_lit { static constexpr const char *get() { return s; } }; return kfmt_lit{}; }())
+
+namespace kfmt {
+  struct segment {
+    usize lit_off;
+    usize lit_len;
+    struct fmt_spec spec;
+    int arg;
+  };
+
+  template<usize N>
+  struct program {
+    segment segs[N + 1];
+    usize nargs;
+    bool valid;
+  };
+
+  constexpr usize count(const char *f) {
+    usize n = 0;
+    for (; *f; f++) {
+      if (*f == '%') {
+        struct fmt_spec spec = {};
+        f = fmt_parse_spec(f + 1, &spec);
+        n++;
+        if (!*f) break;
+      }
+    }
+    return n;
+  }
+
+  constexpr bool consumes_arg(char conv) {
+    return conv != '%';
+  }
+
+  constexpr bool known_conv(const struct fmt_spec& spec) {
+    switch (spec.conv) {
+    case 'x': case 'd': case 'u':
+      return true;
+    case 'p': case 's': case 'a': case 'c': case '%':
+      return !spec.quad;
+    default:
+      return false;
+    }
+  }
+
+  template<usize N>
+  constexpr program<N> parse(const char *f) {
+    program<N> p = {};
+    p.valid = true;
+    const char *base = f;
+    const char *lit = f;
+    usize i = 0;
+    for (; *f; f++) {
+      if (*f != '%') continue;
+      segment& seg = p.segs[i++];
+      seg.lit_off = lit - base;
+      seg.lit_len = f - lit;
+      f = fmt_parse_spec(f + 1, &seg.spec);
+      if (!known_conv(seg.spec)) {
+        p.valid = false;
+        seg.spec.conv = '%';
+      }
+      seg.arg = consumes_arg(seg.spec.conv) ? (int)p.nargs++ : -1;
+      if (!*f) {
+        lit = f;
+        break;
+      }
+      lit = f + 1;
+    }
+    while (*f) f++;
+    p.segs[N].lit_off = lit - base;
+    p.segs[N].lit_len = f - lit;
+    p.segs[N].arg = -1;
+    return p;
+  }
+
+  template<typename Fmt>
+  struct compiled {
+    static constexpr usize n = count(Fmt::get());
+    static constexpr program<n> prog = parse<n>(Fmt::get());
+  };
+
+  template<typename T>
+  constexpr bool is_cstr = traits::is_same<T, char *> || traits::is_same<T, const char *>;
+
+  template<typename T>
+  constexpr bool is_int = traits::is_integral<T> && !traits::is_same<T, bool>;
+
+  template<typename T>
+  struct is_uint_t : traits::false_type {};
+
+  template<usize Limbs>
+  struct is_uint_t<uint_t<Limbs>> : traits::true_type {};
+
+  template<typename T>
+  constexpr bool accepts(const struct fmt_spec& spec) {
+    switch (spec.conv) {
+    case 'a': case 'c':
+      return is_int<T>;
+    case 'd': case 'u': case 'x':
+      return spec.quad ? is_uint_t<T>::value : is_int<T>;
+    case 'p':
+      return traits::is_pointer<T>;
+    case 's':
+      return is_cstr<T> || traits::is_same<T, str_view>;
+    default:
+      return false;
+    }
+  }
+
+  template<usize I, typename T, typename... R>
+  constexpr const auto& nth(const T& t, const R&... r) {
+    if constexpr (I == 0) {
+      return t;
+    } else {
+      return nth<I - 1>(r...);
+    }
+  }
+
+  // %p prints any pointer, a char * included, as its address; only %s
+  // reads through one.
+  template<typename T>
+  inline void emit(struct fmt_buf *out, const struct fmt_spec *spec, const T& v) {
+    if constexpr (is_uint_t<T>::value) {
+      fmt_put_uint(out, v.limbs, T::LIMBS, spec);
+    } else if constexpr (traits::is_same<T, str_view>) {
+      fmt_put_str(out, v.ptr, v.len, spec);
+    } else if constexpr (traits::is_pointer<T>) {
+      if constexpr (is_cstr<T>) {
+        if (spec->conv == 's') {
+          fmt_put_cstr(out, v, spec);
+          return;
+        }
+      }
+      fmt_put_int(out, (u64)v, false, spec);
+    } else if constexpr (traits::is_signed<T>) {
+      if (spec->conv == 'd' || spec->conv == 'a') {
+        fmt_put_int(out, v < 0 ? -(u64)v : (u64)v, v < 0, spec);
+      } else {
+        fmt_put_int(out, (u64)(traits::make_unsigned<T>)v, false, spec);
+      }
+    } else {
+      fmt_put_int(out, (u64)v, false, spec);
+    }
+  }
+
+  template<typename Fmt, usize I, typename... Args>
+  inline void step(struct fmt_buf *out, const Args&... args) {
+    constexpr const segment& seg = compiled<Fmt>::prog.segs[I];
+    if constexpr (seg.lit_len != 0) {
+      fmt_put(out, Fmt::get() + seg.lit_off, seg.lit_len);
+    }
+    if constexpr (seg.arg >= 0 && (usize)seg.arg < sizeof...(Args)) {
+      typedef traits::decay<decltype(nth<seg.arg>(args...))> T;
+      static_assert(accepts<T>(seg.spec), "kformat: argument type does not match its conversion");
+      emit<T>(out, &seg.spec, nth<seg.arg>(args...));
+    } else if constexpr (I < compiled<Fmt>::n && seg.spec.conv == '%') {
+      fmt_put(out, "%", 1);
+    }
+  }
+
+  template<typename Fmt, usize... Is, typename... Args>
+  inline void run(struct fmt_buf *out, traits::index_sequence<Is...>, const Args&... args) {
+    static_assert(compiled<Fmt>::prog.valid, "kformat: unknown conversion in format string");
+    static_assert(compiled<Fmt>::prog.nargs == sizeof...(Args), "kformat: argument count does not match format string");
+    (step<Fmt, Is>(out, args...), ...);
+  }
+}
+
+// Compile-time formatted print into buffer of size bytes; returns the full
+// length like snprintf.
+template<typename Fmt, typename... Args>
+usize kformat(char *buffer, usize size, Fmt, const Args&... args) {
+  struct fmt_buf out = {buffer, size ? size - 1 : 0, 0, 0, nullptr};
+  kfmt::run<Fmt>(&out, traits::make_index_sequence<kfmt::compiled<Fmt>::n + 1>(), args...);
+  if (size) {
+    buffer[out.len] = 0;
+  }
+  return out.flushed + out.len;
+}
+
+template<typename Fmt, typename... Args>
+usize kformat_to(struct fmt_sink sink, Fmt, const Args&... args) {
+  char chunk[FMT_CHUNK];
+  struct fmt_buf out = {chunk, sizeof(chunk), 0, 0, &sink};
+  kfmt::run<Fmt>(&out, traits::make_index_sequence<kfmt::compiled<Fmt>::n + 1>(), args...);
+  fmt_flush(&out);
+  return out.flushed;
+}
+
+template<typename F, typename Fmt, typename... Args>
+usize kformat_to(F&& fn, Fmt f, const Args&... args) {
+  return kformat_to(fmt_make_sink(fn), f, args...);
+}
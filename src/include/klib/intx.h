@@ -1,38 +1,310 @@
 #pragma once
 #include <klib/types.h>
+#include <klib/traits.h>
 
 #define NLIMBS_512 8
 
-class u512 {
+// Decimal conversion works in chunks of 19 digits, the most a limb holds;
+// 10^19 is the chunk radix.
+#define INTX_DEC_CHUNK 19
+#define INTX_DEC_CHUNK_RADIX 10000000000000000000ULL
+
+// Limb-span kernels over little-endian u64 limbs. r receives 2n limbs and
+// must not overlap the inputs. n is at most 64 (4096 bits).
+namespace intx {
+  void mul_wide(u64 *r, const u64 *a, const u64 *b, usize n);
+  void sqr_wide(u64 *r, const u64 *a, usize n);
+  // x[0..n) /= d in place; returns the remainder. d must be nonzero.
+  u64 div_small(u64 *x, usize n, u64 d);
+
+  // *out = a + b + carry; returns the carry out. carry must be 0 or 1. The
+  // x86 intrinsics cannot run at compile time, so constant evaluation takes
+  // the plain carry-compare path.
+  static constexpr inline u64 add_with_carry(u64 a, u64 b, u64 carry, u64 *out) {
+    if (__builtin_is_constant_evaluated()) {
+      u64 sum = a + b;
+      *out = sum + carry;
+      return (sum < a) | (*out < sum);
+    }
+#if __has_builtin(__builtin_addcll)
+    unsigned long long c = 0, sum = __builtin_addcll(a, b, carry, &c);
+    *out = sum;
+    return c;
+#else
+    unsigned long long sum = 0;
+    u64 c = __builtin_ia32_addcarryx_u64((unsigned char)carry, a, b, &sum);
+    *out = sum;
+    return c;
+#endif
+  }
+
+  // *out = a - b - borrow; returns the borrow out. borrow must be 0 or 1.
+  static constexpr inline u64 sub_with_borrow(u64 a, u64 b, u64 borrow, u64 *out) {
+    if (__builtin_is_constant_evaluated()) {
+      u64 diff = a - b;
+      *out = diff - borrow;
+      return (a < b) | (diff < borrow);
+    }
+#if __has_builtin(__builtin_subcll)
+    unsigned long long c = 0, diff = __builtin_subcll(a, b, borrow, &c);
+    *out = diff;
+    return c;
+#else
+    unsigned long long diff = 0;
+    u64 c = __builtin_ia32_sbb_u64((unsigned char)borrow, a, b, &diff);
+    *out = diff;
+    return c;
+#endif
+  }
+
+  // r = a + b + carry over N limbs; r may alias a or b. Returns the carry.
+  template<usize N>
+  static constexpr inline u64 add_n(u64 *r, const u64 *a, const u64 *b, u64 carry = 0) {
+    for (usize i = 0; i < N; i++) {
+      carry = add_with_carry(a[i], b[i], carry, &r[i]);
+    }
+    return carry;
+  }
+
+  // r = a - b - borrow over N limbs; r may alias a or b. Returns the borrow.
+  template<usize N>
+  static constexpr inline u64 sub_n(u64 *r, const u64 *a, const u64 *b, u64 borrow = 0) {
+    for (usize i = 0; i < N; i++) {
+      borrow = sub_with_borrow(a[i], b[i], borrow, &r[i]);
+    }
+    return borrow;
+  }
+}
+
+// Fixed-width unsigned integer of Limbs little-endian 64-bit limbs. Every
+// operation works at exactly this width: results wrap modulo 2^(64*Limbs)
+// and no intermediate is wider than the operation needs. Construction,
+// comparison, add/sub, the truncating multiply and shifts are constexpr and
+// live here; the wide kernels, division and Montgomery arithmetic are
+// instantiated in intx.cc for the widths aliased below only.
+template<usize Limbs>
+class uint_t {
+  static_assert(Limbs >= 2 && Limbs <= 64, "uint_t supports 128 to 4096 bits");
+
 public:
-  u64 limbs[NLIMBS_512] = {0};
+  static constexpr usize LIMBS = Limbs;
+  static constexpr usize BITS = Limbs * 64;
 
-  u512();
+  u64 limbs[Limbs] = {0};
+
+  constexpr uint_t() {}
+  // Zero-extends from T's own width, as the bytes of value.
   template<typename T>
-  u512(T value);
-  u512(u128 v);
-  static u512 from_hex(const char *s);
-  static u512 from_dec(const char *s);
+  constexpr uint_t(T value) {
+    static_assert(sizeof(T) <= 8, "T must be at most 64 bits");
+    limbs[0] = (u64)(traits::make_unsigned<T>)value;
+  }
+  constexpr uint_t(u128 v) {
+    limbs[0] = (u64)v;
+    limbs[1] = (u64)(v >> 64);
+  }
+  static uint_t from_hex(const char *s);
+  static uint_t from_dec(const char *s);
+
+  static uint_t expmod(const uint_t& x, const uint_t& e, const uint_t& m);
+  // Quotient and remainder in one long division.
+  static void divmod(const uint_t& x, const uint_t& y, uint_t& q, uint_t& r);
+  // Full double-width product / square split into low and high halves.
+  static void mul_wide(const uint_t& x, const uint_t& y, uint_t& lo, uint_t& hi);
+  static void sqr_wide(const uint_t& x, uint_t& lo, uint_t& hi);
+  // x * y mod m without truncating the intermediate product.
+  static uint_t mulmod(const uint_t& x, const uint_t& y, const uint_t& m);
+
+  // -1, 0 or 1 as x is less than, equal to or greater than y.
+  static constexpr int cmp(const uint_t& x, const uint_t& y) {
+    for (int i = Limbs - 1; i >= 0; i--) {
+      if (x.limbs[i] != y.limbs[i]) {
+        return x.limbs[i] < y.limbs[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  constexpr int bit_length() const {
+    for (int i = Limbs - 1; i >= 0; i--) {
+      if (limbs[i] != 0) {
+        return i * 64 + 64 - __builtin_clzll(limbs[i]);
+      }
+    }
+    return 0;
+  }
+  constexpr int bit(int index) const { return (limbs[index / 64] >> (index % 64)) & 1; }
+
+  // In-place add / subtract with carry in and out; the carry chains are
+  // inlined into the caller.
+  constexpr u64 adc(const uint_t& y, u64 carry = 0) { return intx::add_n<Limbs>(limbs, limbs, y.limbs, carry); }
+  constexpr u64 sbb(const uint_t& y, u64 borrow = 0) { return intx::sub_n<Limbs>(limbs, limbs, y.limbs, borrow); }
+  // this = this * m + a; returns the limb carried out of the top.
+  constexpr u64 mul_small(u64 m, u64 a = 0) {
+    u64 carry = a;
+    for (usize i = 0; i < Limbs; i++) {
+      u128 t = (u128)limbs[i] * m + carry;
+      limbs[i] = (u64)t;
+      carry = (u64)(t >> 64);
+    }
+    return carry;
+  }
+  // this /= d; returns the remainder.
+  u64 div_small(u64 d) { return intx::div_small(limbs, Limbs, d); }
+
+  constexpr uint_t& operator+=(const uint_t& y) { adc(y); return *this; }
+  constexpr uint_t& operator-=(const uint_t& y) { sbb(y); return *this; }
 
-  static u512 expmod(const u512& x, const u512& e, const u512& m);
+  // Truncating multiply, computed in place without a product temporary. Row
+  // by row from the top: row i only writes limbs i and up, and every lower
+  // row still reads its own, untouched limb of this.
+  constexpr uint_t& operator*=(const uint_t& y) {
+    for (usize i = Limbs; i-- > 0;) {
+      u64 xi = limbs[i];
+      limbs[i] = 0;
+      u64 carry = 0;
+      for (usize j = 0; j < Limbs - i; j++) {
+        u128 t = (u128)xi * y.limbs[j] + limbs[i + j] + carry;
+        limbs[i + j] = (u64)t;
+        carry = (u64)(t >> 64);
+      }
+    }
+    return *this;
+  }
+
+  constexpr uint_t& operator<<=(int n) {
+    int k = n / 64;
+    int s = n % 64;
+    for (int i = Limbs - 1; i >= 0; i--) {
+      u64 hi = i - k >= 0 ? limbs[i - k] : 0;
+      u64 lo = i - k - 1 >= 0 ? limbs[i - k - 1] : 0;
+      limbs[i] = s ? (hi << s) | (lo >> (64 - s)) : hi;
+    }
+    return *this;
+  }
+
+  constexpr uint_t& operator>>=(int n) {
+    int k = n / 64;
+    int s = n % 64;
+    for (int i = 0; i < (int)Limbs; i++) {
+      u64 lo = i + k < (int)Limbs ? limbs[i + k] : 0;
+      u64 hi = i + k + 1 < (int)Limbs ? limbs[i + k + 1] : 0;
+      limbs[i] = s ? (lo >> s) | (hi << (64 - s)) : lo;
+    }
+    return *this;
+  }
+
+  constexpr uint_t& operator&=(const uint_t& y) { for (usize i = 0; i < Limbs; i++) limbs[i] &= y.limbs[i]; return *this; }
+  constexpr uint_t& operator|=(const uint_t& y) { for (usize i = 0; i < Limbs; i++) limbs[i] |= y.limbs[i]; return *this; }
+  constexpr uint_t& operator^=(const uint_t& y) { for (usize i = 0; i < Limbs; i++) limbs[i] ^= y.limbs[i]; return *this; }
+
+  // Defined in the class so mixed operands like x * 10 or m == 1 convert.
+  friend constexpr uint_t operator+(uint_t x, const uint_t& y) { return x += y; }
+  friend constexpr uint_t operator-(uint_t x, const uint_t& y) { return x -= y; }
+  friend constexpr uint_t operator*(uint_t x, const uint_t& y) { return x *= y; }
+  friend uint_t operator/(const uint_t& x, const uint_t& y) {
+    uint_t q, r;
+    divmod(x, y, q, r);
+    return q;
+  }
+  friend uint_t operator%(const uint_t& x, const uint_t& y) {
+    uint_t q, r;
+    divmod(x, y, q, r);
+    return r;
+  }
+
+  friend constexpr uint_t operator<<(uint_t x, int n) { return x <<= n; }
+  friend constexpr uint_t operator>>(uint_t x, int n) { return x >>= n; }
+  friend constexpr uint_t operator&(uint_t x, const uint_t& y) { return x &= y; }
+  friend constexpr uint_t operator|(uint_t x, const uint_t& y) { return x |= y; }
+  friend constexpr uint_t operator^(uint_t x, const uint_t& y) { return x ^= y; }
+  friend constexpr uint_t operator~(uint_t x) {
+    for (usize i = 0; i < Limbs; i++) x.limbs[i] = ~x.limbs[i];
+    return x;
+  }
+
+  friend constexpr bool operator<(const uint_t& x, const uint_t& y) { return cmp(x, y) < 0; }
+  friend constexpr bool operator>(const uint_t& x, const uint_t& y) { return cmp(x, y) > 0; }
+  friend constexpr bool operator<=(const uint_t& x, const uint_t& y) { return cmp(x, y) <= 0; }
+  friend constexpr bool operator>=(const uint_t& x, const uint_t& y) { return cmp(x, y) >= 0; }
+  friend constexpr bool operator==(const uint_t& x, const uint_t& y) { return cmp(x, y) == 0; }
+  friend constexpr bool operator!=(const uint_t& x, const uint_t& y) { return cmp(x, y) != 0; }
 };
 
-u512 operator+(const u512& x, const u512& y);
-u512 operator-(const u512& x, const u512& y);
-u512 operator*(const u512& x, const u512& y);
-u512 operator/(const u512& x, const u512& y);
+typedef uint_t<4> u256;
+typedef uint_t<8> u512;
+typedef uint_t<16> u1024;
+typedef uint_t<32> u2048;
+typedef uint_t<64> u4096;
 
-u512 operator<<(const u512& x, int n);
-u512 operator>>(const u512& x, int n);
-u512 operator|(const u512& x, const u512 &y);
+namespace intx {
+  template<usize Limbs>
+  struct literal {
+    uint_t<Limbs> value;
+    bool ok;
+  };
 
-u512 operator%(const u512& x, const u512& y);
+  // Parses the characters of an integer literal: hex after 0x or 0X,
+  // decimal otherwise, skipping ' digit separators. ok is false for a digit
+  // outside the radix (a floating literal, say) or a value wider than Limbs
+  // limbs.
+  template<usize Limbs>
+  constexpr literal<Limbs> parse_literal(const char *s, usize len) {
+    literal<Limbs> lit = {};
+    lit.ok = true;
+    u64 radix = 10;
+    usize i = 0;
+    if (len > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+      radix = 16;
+      i = 2;
+    }
+    for (; i < len; i++) {
+      char c = s[i];
+      if (c == '\'') continue;
+      u64 digit = c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+      if (digit >= radix || lit.value.mul_small(radix, digit) != 0) {
+        lit.ok = false;
+      }
+    }
+    return lit;
+  }
+}
 
-bool operator<(const u512& x, const u512& y);
-bool operator>(const u512& x, const u512& y);
-bool operator<=(const u512& x, const u512& y);
-bool operator>=(const u512& x, const u512& y);
-bool operator==(const u512& x, const u512& y);
-bool operator!=(const u512& x, const u512& y);
+// 512-bit literal, e.g. 0xffff'0000_u512. Parsed at compile time into a
+// constant, so embedded moduli cost nothing at runtime.
+template<char... Cs>
+constexpr u512 operator""_u512() {
+  constexpr char s[] = {Cs...};
+  constexpr intx::literal<NLIMBS_512> lit = intx::parse_literal<NLIMBS_512>(s, sizeof(s));
+  static_assert(lit.ok, "_u512 literal is not an integer that fits in 512 bits");
+  return lit.value;
+}
+
+// Montgomery arithmetic modulo an odd m with R = 2^(64*Limbs). Values handed
+// to mul() and exp() are in Montgomery form (x * R mod m); to_mont() and
+// from_mont() convert. Building the context costs two long divisions and
+// a squaring, so reuse it when the modulus does not change.
+template<usize Limbs>
+class Montgomery {
+public:
+  typedef uint_t<Limbs> value_type;
+
+  value_type m;
+  value_type r2;  // R^2 mod m
+  value_type one; // R mod m, i.e. 1 in Montgomery form
+  u64 n0;         // -m^-1 mod 2^64
+
+  explicit Montgomery(const value_type& m);
+
+  value_type to_mont(const value_type& x) const;
+  value_type from_mont(const value_type& x) const;
+  value_type mul(const value_type& a, const value_type& b) const;
+  // Sliding-window exponentiation; time depends on the exponent.
+  value_type exp(const value_type& base, const value_type& e) const;
+  // Fixed-window exponentiation whose timing and memory access pattern do
+  // not depend on e. Use it for secret exponents.
+  value_type exp_consttime(const value_type& base, const value_type& e) const;
+};
 
-u512 operator""_u512(const char *s);
+template<usize Limbs>
+Montgomery(const uint_t<Limbs>&) -> Montgomery<Limbs>;
@@ -3,26 +3,75 @@
 #define LIBC_STRING_H
 #include <klib/types.h>
 
+// Non-owning (pointer, length) slice; not NUL-terminated.
+struct str_view {
+    const char *ptr;
+    usize len;
+};
+
+// 256-bit byte membership bitmap, built once and tested in O(1) per byte.
+struct char_set {
+    u64 bits[4];
+};
+
+// Splits [cur, end) on a delimiter set without copying or writing to it.
+struct str_tokenizer {
+    const char *cur;
+    const char *end;
+    struct char_set delims;
+};
+
+// Names of the implementations the CPUID dispatcher picked, for logging.
+struct string_dispatch {
+    const char *memcpy;
+    const char *memset;
+    const char *memmove;
+    const char *memcmp;
+    const char *strlen;
+};
+
 extern "C" {
-void *memcpy(void *dest, const void *src, u32 n);
-void *memset(void *s, int c, u32 n);
-void *memmove(void *dest, const void *src, u32 n);
-u32 strlen(const char *str);
+void *memcpy(void *dest, const void *src, usize n);
+void *memset(void *s, int c, usize n);
+void *memmove(void *dest, const void *src, usize n);
+usize strlen(const char *str);
+const struct string_dispatch *string_dispatch_init();
+const struct string_dispatch *string_dispatch_current();
+void *memchr(const void *s, int c, usize n);
+void *memrchr(const void *s, int c, usize n);
+usize count_dec_digits(u64 value);
+usize count_hex_digits(u64 value);
+usize u64_to_dec(char *buf, u64 value);
+usize s64_to_dec(char *buf, s64 value);
+usize u64_to_hex(char *buf, u64 value);
 char* itoa(s64 value, char *str, int base);
 char* itoa_hex(u64 value, char *str);
 u64 atoi(const char *ptr);
 void strcat(char *dest, const char *src);
 void vsprintf(char *buffer, const char *format, va_list args);
 void sprintf(char *buffer, const char *format, ...);
-u16 strcmp(const char *str1, const char *str2);
-bool memcmp(const void *ptr1, const void *ptr2, u32 n);
+usize vsnprintf(char *buffer, usize size, const char *format, va_list args);
+usize snprintf(char *buffer, usize size, const char *format, ...);
+int strcmp(const char *str1, const char *str2);
+int strncmp(const char *str1, const char *str2, usize n);
+int memcmp(const void *ptr1, const void *ptr2, usize n);
+int bcmp(const void *ptr1, const void *ptr2, usize n);
 char *strtok(const char *str, const char *delim);
+char *strtok_r(char *str, const char *delim, char **saveptr);
+void char_set_init(struct char_set *set, const char *chars);
+void str_tokenizer_init(struct str_tokenizer *tok, const char *str, usize len, const char *delims);
+bool str_tokenizer_next(struct str_tokenizer *tok, struct str_view *out);
 usize strspn( const char* dest, const char* src );
 usize strcspn( const char *dest, const char *src );
 const char* strchr( const char* str, int ch );
 void strcpy(char *dest, const char *src);
 void reverse_str(char *str, usize length);
 //char *strdup(const char *str);
+
+static inline bool char_set_has(const struct char_set *set, char c) {
+    u8 b = (u8)c;
+    return (set->bits[b >> 6] >> (b & 63)) & 1;
+}
 }
 
 #endif
@@ -0,0 +1,80 @@
+#pragma once
+#include <klib/types.h>
+
+// The handful of type traits the templates in klib need, written against
+// the compiler instead of <type_traits>/<utility> so a bare freestanding
+// toolchain without the C++ library headers still builds klib.
+namespace traits {
+  template<bool V>
+  struct bool_constant {
+    static constexpr bool value = V;
+  };
+  typedef bool_constant<true> true_type;
+  typedef bool_constant<false> false_type;
+
+  template<typename T, typename U>
+  constexpr bool is_same = __is_same(T, U);
+
+  template<typename T> struct is_integral_impl : false_type {};
+  template<> struct is_integral_impl<bool> : true_type {};
+  template<> struct is_integral_impl<char> : true_type {};
+  template<> struct is_integral_impl<signed char> : true_type {};
+  template<> struct is_integral_impl<unsigned char> : true_type {};
+  template<> struct is_integral_impl<short> : true_type {};
+  template<> struct is_integral_impl<unsigned short> : true_type {};
+  template<> struct is_integral_impl<int> : true_type {};
+  template<> struct is_integral_impl<unsigned int> : true_type {};
+  template<> struct is_integral_impl<long> : true_type {};
+  template<> struct is_integral_impl<unsigned long> : true_type {};
+  template<> struct is_integral_impl<long long> : true_type {};
+  template<> struct is_integral_impl<unsigned long long> : true_type {};
+  template<> struct is_integral_impl<char16_t> : true_type {};
+  template<> struct is_integral_impl<char32_t> : true_type {};
+  template<> struct is_integral_impl<wchar_t> : true_type {};
+
+  template<typename T> struct remove_cv { typedef T type; };
+  template<typename T> struct remove_cv<const T> { typedef T type; };
+  template<typename T> struct remove_cv<volatile T> { typedef T type; };
+  template<typename T> struct remove_cv<const volatile T> { typedef T type; };
+
+  template<typename T>
+  constexpr bool is_integral = is_integral_impl<typename remove_cv<T>::type>::value;
+
+  template<typename T> struct is_pointer_impl : false_type {};
+  template<typename T> struct is_pointer_impl<T *> : true_type {};
+
+  template<typename T>
+  constexpr bool is_pointer = is_pointer_impl<typename remove_cv<T>::type>::value;
+
+  template<typename T, bool = is_integral<T>> struct is_signed_impl : false_type {};
+  template<typename T> struct is_signed_impl<T, true> : bool_constant<(T)-1 < (T)0> {};
+
+  template<typename T>
+  constexpr bool is_signed = is_signed_impl<T>::value;
+
+  // The unsigned integer of T's width.
+  template<usize Size> struct unsigned_of_size;
+  template<> struct unsigned_of_size<1> { typedef u8 type; };
+  template<> struct unsigned_of_size<2> { typedef u16 type; };
+  template<> struct unsigned_of_size<4> { typedef u32 type; };
+  template<> struct unsigned_of_size<8> { typedef u64 type; };
+
+  template<typename T>
+  using make_unsigned = typename unsigned_of_size<sizeof(T)>::type;
+
+  // By-value type of an argument: no reference or cv, arrays as pointers.
+  template<typename T> struct decay_impl { typedef typename remove_cv<T>::type type; };
+  template<typename T> struct decay_impl<T &> : decay_impl<T> {};
+  template<typename T> struct decay_impl<T[]> { typedef T *type; };
+  template<typename T, usize N> struct decay_impl<T[N]> { typedef T *type; };
+
+  template<typename T>
+  using decay = typename decay_impl<T>::type;
+
+  template<usize... Is>
+  struct index_sequence {};
+
+  // GCC's builtin pack expansion, the one <utility> itself uses.
+  template<usize N>
+  using make_index_sequence = index_sequence<__integer_pack(N)...>;
+}
@@ -0,0 +1,32 @@
+#include <klib/cpu.h>
+
+#define CPUID7_EBX_BMI1 (1 << 3)
+#define CPUID7_EBX_BMI2 (1 << 8)
+#define CPUID7_EBX_ERMS (1 << 9)
+#define CPUID7_EBX_ADX  (1 << 19)
+#define CPUID7_EDX_FSRM (1 << 4)
+
+static struct cpu_features features;
+static bool probed = false;
+
+static void cpuid(u32 leaf, u32 subleaf, u32 *a, u32 *b, u32 *c, u32 *d) {
+  asm volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(subleaf));
+}
+
+// Probing is idempotent, so two CPUs racing through here is harmless.
+const struct cpu_features *cpu_get_features() {
+  if (probed) return &features;
+
+  u32 a, b, c, d;
+  cpuid(0, 0, &a, &b, &c, &d);
+  if (a >= 7) {
+    cpuid(7, 0, &a, &b, &c, &d);
+    features.bmi1 = b & CPUID7_EBX_BMI1;
+    features.bmi2 = b & CPUID7_EBX_BMI2;
+    features.erms = b & CPUID7_EBX_ERMS;
+    features.adx = b & CPUID7_EBX_ADX;
+    features.fsrm = d & CPUID7_EDX_FSRM;
+  }
+  probed = true;
+  return &features;
+}
@@ -0,0 +1,123 @@
+#include <klib/crypto/sha256.h>
+#include <klib/string.h>
+
+static const u32 round_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline u32 ror(u32 x, int n) {
+  return (x >> n) | (x << (32 - n));
+}
+
+static inline u32 load_be32(const u8 *p) {
+  return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(u8 *p, u32 v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+// The message schedule lives in a 16-word ring so the whole block state fits
+// in registers plus one cache line.
+static void compress(u32 *state, const u8 *block) {
+  u32 w[16];
+  for (int i = 0; i < 16; i++) {
+    w[i] = load_be32(block + 4 * i);
+  }
+
+  u32 a = state[0], b = state[1], c = state[2], d = state[3];
+  u32 e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    if (i >= 16) {
+      u32 w15 = w[(i - 15) & 15];
+      u32 w2 = w[(i - 2) & 15];
+      u32 s0 = ror(w15, 7) ^ ror(w15, 18) ^ (w15 >> 3);
+      u32 s1 = ror(w2, 17) ^ ror(w2, 19) ^ (w2 >> 10);
+      w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+    }
+    u32 t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + round_k[i] + w[i & 15];
+    u32 t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+void sha256_init(struct sha256_ctx *ctx) {
+  static const u32 iv[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+  };
+  memcpy(ctx->state, iv, sizeof(iv));
+  ctx->len = 0;
+  ctx->buf_len = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, const void *data, usize len) {
+  const u8 *p = (const u8 *)data;
+  ctx->len += len;
+  if (ctx->buf_len) {
+    usize take = SHA256_BLOCK_SIZE - ctx->buf_len;
+    if (take > len) take = len;
+    memcpy(ctx->buf + ctx->buf_len, p, take);
+    ctx->buf_len += take;
+    p += take;
+    len -= take;
+    if (ctx->buf_len < SHA256_BLOCK_SIZE) return;
+    compress(ctx->state, ctx->buf);
+    ctx->buf_len = 0;
+  }
+  // whole blocks are hashed straight from the caller's buffer
+  for (; len >= SHA256_BLOCK_SIZE; p += SHA256_BLOCK_SIZE, len -= SHA256_BLOCK_SIZE) {
+    compress(ctx->state, p);
+  }
+  memcpy(ctx->buf, p, len);
+  ctx->buf_len = len;
+}
+
+void sha256_final(struct sha256_ctx *ctx, u8 *digest) {
+  u64 bits = ctx->len * 8;
+  ctx->buf[ctx->buf_len++] = 0x80;
+  if (ctx->buf_len > SHA256_BLOCK_SIZE - 8) {
+    memset(ctx->buf + ctx->buf_len, 0, SHA256_BLOCK_SIZE - ctx->buf_len);
+    compress(ctx->state, ctx->buf);
+    ctx->buf_len = 0;
+  }
+  memset(ctx->buf + ctx->buf_len, 0, SHA256_BLOCK_SIZE - 8 - ctx->buf_len);
+  store_be32(ctx->buf + 56, bits >> 32);
+  store_be32(ctx->buf + 60, (u32)bits);
+  compress(ctx->state, ctx->buf);
+
+  for (int i = 0; i < 8; i++) {
+    store_be32(digest + 4 * i, ctx->state[i]);
+  }
+}
+
+void sha256(const void *data, usize len, u8 *digest) {
+  struct sha256_ctx ctx;
+  sha256_init(&ctx);
+  sha256_update(&ctx, data, len);
+  sha256_final(&ctx, digest);
+}
@@ -1,61 +1,176 @@
 #include <klib/elf.h>
 #include <klib/assert.h>
 #include <klib/string.h>
+#include <klib/memory.h>
 #include <klib/dwarf.h>
 
+u32 elf_gnu_hash(const char *name) {
+  u32 h = 5381;
+  for (const u8 *p = (const u8 *)name; *p; p++) {
+    h = h * 33 + *p;
+  }
+  return h;
+}
+
+bool elf_section_in_image(const struct elf_desc *desc, const struct elf_shdr *shdr) {
+  if (shdr->sh_type == SHT_NOBITS) return true;
+  return shdr->sh_offset <= desc->size && shdr->sh_size <= desc->size - shdr->sh_offset;
+}
+
+// A string table inside the image whose last string is terminated, so any
+// offset below its size names a whole string.
+static bool string_table(const struct elf_desc *desc, const struct elf_shdr *shdr) {
+  return shdr->sh_type == SHT_STRTAB && shdr->sh_size != 0 && elf_section_in_image(desc, shdr)
+      && ((const char *)desc->raw_ptr)[shdr->sh_offset + shdr->sh_size - 1] == 0;
+}
+
+// A symbol table inside the image linked to a valid string table, or null.
+static struct elf_shdr *symbol_table(const struct elf_desc *desc, struct elf_shdr *shdr) {
+  if (!elf_section_in_image(desc, shdr) || shdr->sh_link >= desc->shnum
+      || !string_table(desc, &desc->shdrs[shdr->sh_link])) {
+    return nullptr;
+  }
+  return shdr;
+}
+
+// First section of a name wins; later duplicates (.group, say) are left to
+// a walk of shdrs. Sections whose name lies outside shstrtab go unnamed.
+static void index_section(struct elf_desc *desc, u32 i) {
+  if (desc->shdrs[i].sh_name >= desc->shstrtab_shdr->sh_size) return;
+  const char *name = desc->shstrtab + desc->shdrs[i].sh_name;
+  u32 h = elf_gnu_hash(name);
+  for (u32 j = h & desc->sections.mask;; j = (j + 1) & desc->sections.mask) {
+    struct elf_name_slot *slot = &desc->sections.slots[j];
+    if (slot->index == 0) {
+      slot->hash = h;
+      slot->index = i + 1;
+      return;
+    }
+    if (slot->hash == h && strcmp(desc->shstrtab + desc->shdrs[slot->index - 1].sh_name, name) == 0) {
+      return;
+    }
+  }
+}
+
+// The DWARF reader takes these sections as given, so only ones inside the
+// image are kept.
+static struct elf_shdr *debug_section(const struct elf_desc *desc, const char *name) {
+  struct elf_shdr *shdr = elf_find_section(desc, name);
+  return shdr && shdr->sh_type != SHT_NOBITS && elf_section_in_image(desc, shdr) ? shdr : nullptr;
+}
+
 void elf_parse(struct elf_desc *desc, void *data, usize size) {
   assert(size >= sizeof(struct elf_header), "Invalid ELF file");
   desc->header = (struct elf_header *)data;
   desc->raw_ptr = data;
+  desc->size = size;
   assert(*((u32*)desc->header->e_ident.magic) == 0x464c457f, "Invalid ELF magic");
   desc->phdrs = (struct elf_phdr *)(data + desc->header->e_phoff);
   desc->shdrs = (struct elf_shdr *)(data + desc->header->e_shoff);
   desc->symtab = nullptr;
+  desc->dynsym = nullptr;
+  desc->dynstr = nullptr;
+  desc->sects = {};
+  desc->debug = {};
+  desc->names = {};
   desc->strtab = nullptr;
-  desc->shstrtab = nullptr;
-  desc->shstrtab_shdr = nullptr;
 
-  struct elf_shdr *possible_dbg[16];
-  int dbg_count = 0;
-  for (usize i = 0; i < desc->header->e_shnum; i++) {
+  // Past SHN_LORESERVE sections the real count and string table index live
+  // in section 0.
+  assert(desc->header->e_shoff != 0 && desc->header->e_shoff <= size
+         && size - desc->header->e_shoff >= sizeof(struct elf_shdr), "No section headers");
+  desc->shnum = desc->header->e_shnum;
+  if (desc->shnum == 0) {
+    desc->shnum = desc->shdrs[0].sh_size;
+  }
+  assert(desc->shnum <= (size - desc->header->e_shoff) / sizeof(struct elf_shdr), "Section headers out of bounds");
+  usize shstrndx = desc->header->e_shstrndx;
+  if (shstrndx == SHN_XINDEX) {
+    shstrndx = desc->shdrs[0].sh_link;
+  }
+  assert(shstrndx < desc->shnum && string_table(desc, &desc->shdrs[shstrndx]),
+         "No section header string table found");
+  desc->shstrtab_shdr = &desc->shdrs[shstrndx];
+  desc->shstrtab = (char *)(data + desc->shstrtab_shdr->sh_offset);
+
+  // at most half full, so probe runs stay short
+  usize cap = 16;
+  while (cap < 2 * desc->shnum) cap *= 2;
+  desc->sections.slots = (struct elf_name_slot *)kmalloc(cap * sizeof(struct elf_name_slot));
+  assert(desc->sections.slots != nullptr, "Out of memory for section index");
+  memset(desc->sections.slots, 0, cap * sizeof(struct elf_name_slot));
+  desc->sections.mask = cap - 1;
+  memset(desc->by_type, 0, sizeof(desc->by_type));
+
+  // Tables that lie outside the image, or whose string table does, are
+  // treated as absent rather than trusted.
+  for (usize i = 1; i < desc->shnum; i++) {
     struct elf_shdr *shdr = &desc->shdrs[i];
-    if (shdr->sh_type == SHT_SYMTAB) {
+    if (shdr->sh_type < ELF_SHT_INDEXED && desc->by_type[shdr->sh_type] == 0) {
+      desc->by_type[shdr->sh_type] = i;
+    }
+    switch (shdr->sh_type) {
+    case SHT_SYMTAB:
+      if (desc->sects.symtab || !symbol_table(desc, shdr)) break;
       desc->symtab = (struct elf_sym *)(data + shdr->sh_offset);
       desc->strtab = (const char *)(data + desc->shdrs[shdr->sh_link].sh_offset);
       desc->sects.symtab = shdr;
-    } else if (shdr->sh_type == SHT_STRTAB && i == desc->header->e_shstrndx) {
-      desc->shstrtab = (char *)(data + shdr->sh_offset);
-      desc->shstrtab_shdr = shdr;
+      break;
+    case SHT_DYNSYM:
+      if (desc->sects.dynsym || !symbol_table(desc, shdr)) break;
+      desc->dynsym = (struct elf_sym *)(data + shdr->sh_offset);
+      desc->dynstr = (const char *)(data + desc->shdrs[shdr->sh_link].sh_offset);
+      desc->sects.dynsym = shdr;
+      break;
+    case SHT_GNU_HASH:
+      if (!desc->sects.gnu_hash && elf_section_in_image(desc, shdr)) desc->sects.gnu_hash = shdr;
+      break;
+    case SHT_HASH:
+      if (!desc->sects.hash && elf_section_in_image(desc, shdr)) desc->sects.hash = shdr;
+      break;
     }
-    if (shdr->sh_type == SHT_PROGBITS
-    && (shdr->sh_flags == 0 || shdr->sh_flags == (SHF_MERGE | SHF_STRINGS))
-    && shdr->sh_addralign == 1) {
+    index_section(desc, i);
+  }
+
+  desc->debug.debug_info = debug_section(desc, ".debug_info");
+  desc->debug.debug_abbrev = debug_section(desc, ".debug_abbrev");
+  desc->debug.debug_loclist = debug_section(desc, ".debug_loclists");
+  desc->debug.debug_line = debug_section(desc, ".debug_line");
+  desc->debug.debug_str = debug_section(desc, ".debug_str");
+  desc->debug.debug_line_str = debug_section(desc, ".debug_line_str");
 
-      possible_dbg[dbg_count++] = shdr;
+  elf_index_names(desc);
+}
+
+void elf_free(struct elf_desc *desc) {
+  kfree(desc->sections.slots);
+  desc->sections = {};
+  elf_free_names(desc);
+}
+
+struct elf_shdr *elf_find_section(const struct elf_desc *desc, const char *name) {
+  u32 h = elf_gnu_hash(name);
+  for (u32 j = h & desc->sections.mask;; j = (j + 1) & desc->sections.mask) {
+    const struct elf_name_slot *slot = &desc->sections.slots[j];
+    if (slot->index == 0) return nullptr;
+    struct elf_shdr *shdr = &desc->shdrs[slot->index - 1];
+    if (slot->hash == h && strcmp(desc->shstrtab + shdr->sh_name, name) == 0) {
+      return shdr;
     }
   }
+}
 
-  for (int i = 0; i < dbg_count; i++) {
-    struct elf_shdr *shdr = possible_dbg[i];
-    if (!shdr) break;
-    char *name = desc->shstrtab + shdr->sh_name;
-    if (strcmp(name, ".debug_info") == 0) {
-      desc->debug.debug_info = shdr;
-    } else if (strcmp(name, ".debug_abbrev") == 0) {
-      desc->debug.debug_abbrev = shdr;
-    } else if (strcmp(name, ".debug_loclist") == 0) {
-      desc->debug.debug_loclist = shdr;
-    } else if (strcmp(name, ".debug_line") == 0) {
-      desc->debug.debug_line = shdr;
-    } else if (strcmp(name, ".debug_str") == 0) {
-      desc->debug.debug_str = shdr;
-    } else if (strcmp(name, ".debug_line_str") == 0) {
-      desc->debug.debug_line_str = shdr;
-    }
+struct elf_shdr *elf_find_section_type(const struct elf_desc *desc, u32 type) {
+  if (type < ELF_SHT_INDEXED) {
+    return desc->by_type[type] ? &desc->shdrs[desc->by_type[type]] : nullptr;
   }
+  for (usize i = 1; i < desc->shnum; i++) {
+    if (desc->shdrs[i].sh_type == type) return &desc->shdrs[i];
+  }
+  return nullptr;
+}
 
-  assert(desc->symtab != NULL, "No symbol table found");
-  assert(desc->strtab != NULL, "No string table found");
-  assert(desc->shstrtab != NULL, "No section header string table found");
-  assert(desc->shstrtab_shdr != NULL, "No section header string table section found");
+void *elf_section_data(const struct elf_desc *desc, const struct elf_shdr *shdr) {
+  if (shdr->sh_type == SHT_NOBITS) return nullptr;
+  return desc->raw_ptr + shdr->sh_offset;
 }
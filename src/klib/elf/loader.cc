@@ -0,0 +1,67 @@
+#include <klib/elf.h>
+#include <klib/assert.h>
+#include <klib/string.h>
+
+static inline u64 page_down(u64 x) {
+  return x & ~(u64)(ELF_PAGE_SIZE - 1);
+}
+
+static inline u64 page_up(u64 x) {
+  return page_down(x + ELF_PAGE_SIZE - 1);
+}
+
+static void plan_segment(const struct elf_phdr *ph, struct elf_segment_plan *plan) {
+  u64 file_end = ph->p_vaddr + ph->p_filesz;
+  plan->vaddr = page_down(ph->p_vaddr);
+  plan->size = page_up(ph->p_vaddr + ph->p_memsz) - plan->vaddr;
+  plan->flags = ph->p_flags & (PF_R | PF_W | PF_X);
+  plan->map = {};
+  plan->copy[0] = {ph->p_vaddr, ph->p_offset, ph->p_filesz};
+  plan->copy[1] = {};
+  plan->zero_vaddr = file_end;
+  plan->zero_size = ph->p_memsz - ph->p_filesz;
+
+  // file pages can only be shared when they line up with memory pages
+  if ((ph->p_vaddr ^ ph->p_offset) & (ELF_PAGE_SIZE - 1)) return;
+  u64 map_start = page_up(ph->p_vaddr);
+  u64 map_end = page_down(file_end);
+  if (map_end <= map_start) return;
+
+  plan->map = {map_start, ph->p_offset + (map_start - ph->p_vaddr), map_end - map_start};
+  plan->copy[0].size = map_start - ph->p_vaddr;
+  plan->copy[1] = {map_end, ph->p_offset + (map_end - ph->p_vaddr), file_end - map_end};
+}
+
+usize elf_load_plan(const struct elf_desc *desc, struct elf_segment_plan *plans, usize cap) {
+  const struct elf_header *hdr = desc->header;
+  assert(hdr->e_phoff <= desc->size && hdr->e_phnum <= (desc->size - hdr->e_phoff) / sizeof(struct elf_phdr),
+         "Program headers out of bounds");
+
+  usize n = 0;
+  for (usize i = 0; i < hdr->e_phnum; i++) {
+    const struct elf_phdr *ph = &desc->phdrs[i];
+    if (ph->p_type != PT_LOAD) continue;
+    assert(ph->p_filesz <= ph->p_memsz, "Segment file size exceeds memory size");
+    assert(ph->p_offset <= desc->size && ph->p_filesz <= desc->size - ph->p_offset, "Segment out of bounds");
+    if (n < cap) {
+      plan_segment(ph, &plans[n]);
+    }
+    n++;
+  }
+  return n;
+}
+
+void elf_load_segment(const struct elf_desc *desc, const struct elf_segment_plan *plan, void *dest, bool copy_mapped) {
+  u8 *base = (u8 *)dest - plan->vaddr;
+  const u8 *file = (const u8 *)desc->raw_ptr;
+  for (int i = 0; i < 2; i++) {
+    const struct elf_run *run = &plan->copy[i];
+    if (run->size) memcpy(base + run->vaddr, file + run->offset, run->size);
+  }
+  if (copy_mapped && plan->map.size) {
+    memcpy(base + plan->map.vaddr, file + plan->map.offset, plan->map.size);
+  }
+  if (plan->zero_size) {
+    memset(base + plan->zero_vaddr, 0, plan->zero_size);
+  }
+}
@@ -0,0 +1,212 @@
+#include <klib/elf.h>
+#include <klib/memory.h>
+#include <klib/string.h>
+
+#define SYM_UNKNOWN 0
+#define SYM_RESOLVED 1
+#define SYM_UNRESOLVED 2
+
+enum elf_reloc_status elf_module_init(struct elf_module *mod, const struct elf_desc *desc,
+                                      const struct elf_placement *place, const struct elf_resolver *resolver,
+                                      struct elf_placement got, usize got_cap) {
+  mod->syms = nullptr;
+  if (desc->header->e_type != ET_REL || !desc->sects.symtab) {
+    return ELF_RELOC_BAD_IMAGE;
+  }
+  usize nsyms = desc->sects.symtab->sh_size / sizeof(struct elf_sym);
+  // one spare entry so an empty symtab still gets an allocation
+  mod->syms = (struct elf_module_sym *)kmalloc((nsyms + 1) * sizeof(struct elf_module_sym));
+  if (!mod->syms) return ELF_RELOC_NO_MEMORY;
+  memset(mod->syms, 0, nsyms * sizeof(struct elf_module_sym));
+  mod->nsyms = nsyms;
+  mod->desc = desc;
+  mod->place = place;
+  mod->resolver = *resolver;
+  mod->got = got;
+  mod->got_cap = got_cap;
+  mod->got_used = 0;
+  return ELF_RELOC_OK;
+}
+
+void elf_module_free(struct elf_module *mod) {
+  kfree(mod->syms);
+  mod->syms = nullptr;
+}
+
+// The cache entry of symbol index, resolving it on first use; null when the
+// index is past the end of symtab.
+static struct elf_module_sym *lookup(struct elf_module *mod, u32 index) {
+  if (index >= mod->nsyms) return nullptr;
+  struct elf_module_sym *ms = &mod->syms[index];
+  if (ms->state != SYM_UNKNOWN) return ms;
+
+  const struct elf_sym *s = &mod->desc->symtab[index];
+  ms->state = SYM_RESOLVED;
+  if (index == 0) {
+    ms->addr = 0;
+  } else if (s->st_shndx == SHN_UNDEF) {
+    ms->addr = mod->resolver.resolve(mod->resolver.ctx, mod->desc->strtab + s->st_name);
+    if (ms->addr == 0 && ELF64_ST_BIND(s->st_info) != STB_WEAK) {
+      ms->state = SYM_UNRESOLVED;
+    }
+  } else if (s->st_shndx == SHN_ABS) {
+    ms->addr = s->st_value;
+  } else if (s->st_shndx >= SHN_LORESERVE || s->st_shndx >= mod->desc->shnum
+          || mod->place[s->st_shndx].addr == 0) {
+    ms->state = SYM_UNRESOLVED;
+  } else {
+    ms->addr = mod->place[s->st_shndx].addr + s->st_value;
+  }
+  return ms;
+}
+
+// RELA sections that apply to a loaded section through the symbol table.
+static bool applies(const struct elf_module *mod, const struct elf_shdr *shdr) {
+  return shdr->sh_type == SHT_RELA && &mod->desc->shdrs[shdr->sh_link] == mod->desc->sects.symtab
+      && shdr->sh_info < mod->desc->shnum && mod->place[shdr->sh_info].addr != 0;
+}
+
+usize elf_module_resolve(struct elf_module *mod, u32 *unresolved, usize cap) {
+  const struct elf_desc *desc = mod->desc;
+  for (usize i = 0; i < desc->shnum; i++) {
+    const struct elf_shdr *shdr = &desc->shdrs[i];
+    if (!applies(mod, shdr) || !elf_section_in_image(desc, shdr)) continue;
+    const struct elf_rela *rela = (const struct elf_rela *)(desc->raw_ptr + shdr->sh_offset);
+    usize count = shdr->sh_size / sizeof(struct elf_rela);
+    for (usize j = 0; j < count; j++) {
+      lookup(mod, ELF64_R_SYM(rela[j].r_info));
+    }
+  }
+
+  usize n = 0;
+  for (usize i = 0; i < mod->nsyms; i++) {
+    if (mod->syms[i].state != SYM_UNRESOLVED) continue;
+    if (n < cap) unresolved[n] = i;
+    n++;
+  }
+  return n;
+}
+
+static bool got_slot(struct elf_module *mod, struct elf_module_sym *ms, u64 *addr) {
+  if (ms->got == 0) {
+    if (mod->got_used == mod->got_cap) return false;
+    ((u64 *)mod->got.mem)[mod->got_used] = ms->addr;
+    ms->got = ++mod->got_used;
+  }
+  *addr = mod->got.addr + (ms->got - 1) * sizeof(u64);
+  return true;
+}
+
+static inline bool fits_s32(s64 v) {
+  return v == (s32)v;
+}
+
+static inline void put64(u8 *p, u64 v) { __builtin_memcpy(p, &v, 8); }
+static inline void put32(u8 *p, u32 v) { __builtin_memcpy(p, &v, 4); }
+static inline void put16(u8 *p, u16 v) { __builtin_memcpy(p, &v, 2); }
+
+// Field width of each relocation type, 0 when unsupported.
+static usize width(u32 type) {
+  switch (type) {
+  case R_X86_64_NONE:
+    return 0;
+  case R_X86_64_64: case R_X86_64_PC64: case R_X86_64_GOTOFF64:
+    return 8;
+  case R_X86_64_16: case R_X86_64_PC16:
+    return 2;
+  case R_X86_64_8: case R_X86_64_PC8:
+    return 1;
+  default:
+    return 4;
+  }
+}
+
+static enum elf_reloc_status apply(struct elf_module *mod, const struct elf_rela *r, u8 *mem, u64 base) {
+  u32 type = ELF64_R_TYPE(r->r_info);
+  struct elf_module_sym *ms = lookup(mod, ELF64_R_SYM(r->r_info));
+  if (!ms) return ELF_RELOC_BAD_SYMBOL;
+  if (ms->state != SYM_RESOLVED) return ELF_RELOC_UNRESOLVED;
+
+  u8 *loc = mem + r->r_offset;
+  u64 s = ms->addr;
+  u64 a = r->r_addend;
+  u64 p = base + r->r_offset;
+  u64 g = 0;
+  s64 v = 0;
+  switch (type) {
+  case R_X86_64_NONE:
+    return ELF_RELOC_OK;
+  case R_X86_64_64:
+    put64(loc, s + a);
+    return ELF_RELOC_OK;
+  case R_X86_64_PC64:
+    put64(loc, s + a - p);
+    return ELF_RELOC_OK;
+  case R_X86_64_GOTOFF64:
+    put64(loc, s + a - mod->got.addr);
+    return ELF_RELOC_OK;
+  case R_X86_64_32:
+    if (s + a > 0xffffffff) return ELF_RELOC_OVERFLOW;
+    put32(loc, s + a);
+    return ELF_RELOC_OK;
+  case R_X86_64_32S:
+    v = s + a;
+    break;
+  case R_X86_64_PC32:
+  case R_X86_64_PLT32:
+    v = s + a - p;
+    break;
+  case R_X86_64_GOTPC32:
+    v = mod->got.addr + a - p;
+    break;
+  case R_X86_64_GOT32:
+    if (!got_slot(mod, ms, &g)) return ELF_RELOC_GOT_FULL;
+    v = g - mod->got.addr + a;
+    break;
+  case R_X86_64_GOTPCREL:
+  case R_X86_64_GOTPCRELX:
+  case R_X86_64_REX_GOTPCRELX:
+    if (!got_slot(mod, ms, &g)) return ELF_RELOC_GOT_FULL;
+    v = g + a - p;
+    break;
+  case R_X86_64_16:
+  case R_X86_64_PC16:
+    v = type == R_X86_64_16 ? s + a : s + a - p;
+    if (v < -0x8000 || v > 0xffff) return ELF_RELOC_OVERFLOW;
+    put16(loc, v);
+    return ELF_RELOC_OK;
+  case R_X86_64_8:
+  case R_X86_64_PC8:
+    v = type == R_X86_64_8 ? s + a : s + a - p;
+    if (v < -0x80 || v > 0xff) return ELF_RELOC_OVERFLOW;
+    *loc = v;
+    return ELF_RELOC_OK;
+  default:
+    return ELF_RELOC_UNSUPPORTED;
+  }
+  if (!fits_s32(v)) return ELF_RELOC_OVERFLOW;
+  put32(loc, v);
+  return ELF_RELOC_OK;
+}
+
+enum elf_reloc_status elf_module_relocate(struct elf_module *mod) {
+  const struct elf_desc *desc = mod->desc;
+  for (usize i = 0; i < desc->shnum; i++) {
+    const struct elf_shdr *shdr = &desc->shdrs[i];
+    if (!applies(mod, shdr)) continue;
+    if (!elf_section_in_image(desc, shdr)) return ELF_RELOC_BAD_IMAGE;
+    const struct elf_placement *target = &mod->place[shdr->sh_info];
+    u64 limit = desc->shdrs[shdr->sh_info].sh_size;
+    const struct elf_rela *rela = (const struct elf_rela *)(desc->raw_ptr + shdr->sh_offset);
+    usize count = shdr->sh_size / sizeof(struct elf_rela);
+    for (usize j = 0; j < count; j++) {
+      const struct elf_rela *r = &rela[j];
+      if (r->r_offset > limit || width(ELF64_R_TYPE(r->r_info)) > limit - r->r_offset) {
+        return ELF_RELOC_BAD_OFFSET;
+      }
+      enum elf_reloc_status st = apply(mod, r, (u8 *)target->mem, target->addr);
+      if (st != ELF_RELOC_OK) return st;
+    }
+  }
+  return ELF_RELOC_OK;
+}
@@ -0,0 +1,288 @@
+#include <klib/elf.h>
+#include <klib/assert.h>
+#include <klib/memory.h>
+#include <klib/string.h>
+
+// Entries in symtab; none in a stripped image.
+static usize symtab_count(const struct elf_desc *desc) {
+  return desc->sects.symtab ? desc->sects.symtab->sh_size / sizeof(struct elf_sym) : 0;
+}
+
+// Size of the string table a symbol table's names point into; elf_parse
+// has checked that it is one.
+static usize names_size(const struct elf_desc *desc, const struct elf_shdr *table) {
+  return table ? desc->shdrs[table->sh_link].sh_size : 0;
+}
+
+static bool wanted(const struct elf_sym *s, usize names) {
+  u8 type = ELF64_ST_TYPE(s->st_info);
+  return (type == STT_FUNC || type == STT_OBJECT) && s->st_shndx != SHN_UNDEF && s->st_name < names;
+}
+
+// Orders by address, and the larger of two symbols at one address first so
+// deduplication keeps it.
+static bool before(const struct elf_symbol& a, const struct elf_symbol& b) {
+  return a.start != b.start ? a.start < b.start : a.size > b.size;
+}
+
+static void sift_down(struct elf_symbol *v, usize root, usize n) {
+  for (;;) {
+    usize child = 2 * root + 1;
+    if (child >= n) break;
+    if (child + 1 < n && before(v[child], v[child + 1])) child++;
+    if (!before(v[root], v[child])) break;
+    struct elf_symbol t = v[root];
+    v[root] = v[child];
+    v[child] = t;
+    root = child;
+  }
+}
+
+// Heapsort: no recursion and no scratch, and symbol tables are too big for
+// anything quadratic.
+static void sort_symbols(struct elf_symbol *v, usize n) {
+  for (usize i = n / 2; i-- > 0;) {
+    sift_down(v, i, n);
+  }
+  for (usize end = n; end-- > 1;) {
+    struct elf_symbol t = v[0];
+    v[0] = v[end];
+    v[end] = t;
+    sift_down(v, 0, end);
+  }
+}
+
+// In-order walk of the implicit tree rooted at k, consuming sorted input.
+static usize fill_eytzinger(struct elf_symbol *out, usize n, const struct elf_symbol *sorted, usize i, usize k) {
+  if (k <= n) {
+    i = fill_eytzinger(out, n, sorted, i, 2 * k);
+    out[k] = sorted[i++];
+    i = fill_eytzinger(out, n, sorted, i, 2 * k + 1);
+  }
+  return i;
+}
+
+void elf_symbolizer_init(struct elf_symbolizer *sym, const struct elf_desc *desc) {
+  usize total = symtab_count(desc);
+  usize names = names_size(desc, desc->sects.symtab);
+  usize n = 0;
+  for (usize i = 0; i < total; i++) {
+    if (wanted(&desc->symtab[i], names)) n++;
+  }
+
+  // one spare entry so an image without symbols still gets an allocation;
+  // the index is then empty and every lookup misses
+  struct elf_symbol *sorted = (struct elf_symbol *)kmalloc((n + 1) * sizeof(struct elf_symbol));
+  assert(sorted != nullptr, "Out of memory for symbol index");
+  n = 0;
+  for (usize i = 0; i < total; i++) {
+    const struct elf_sym *s = &desc->symtab[i];
+    if (!wanted(s, names)) continue;
+    sorted[n].start = s->st_value;
+    sorted[n].size = s->st_size > 0xffffffff ? 0xffffffff : (u32)s->st_size;
+    sorted[n].name = s->st_name;
+    n++;
+  }
+  sort_symbols(sorted, n);
+
+  usize kept = 0;
+  for (usize i = 0; i < n; i++) {
+    if (kept && sorted[kept - 1].start == sorted[i].start) continue;
+    sorted[kept++] = sorted[i];
+  }
+  for (usize i = 0; i + 1 < kept; i++) {
+    if (sorted[i].size == 0) {
+      u64 gap = sorted[i + 1].start - sorted[i].start;
+      sorted[i].size = gap > 0xffffffff ? 0xffffffff : (u32)gap;
+    }
+  }
+
+  sym->syms = (struct elf_symbol *)kmalloc((kept + 1) * sizeof(struct elf_symbol));
+  assert(sym->syms != nullptr, "Out of memory for symbol index");
+  sym->syms[0] = {};
+  fill_eytzinger(sym->syms, kept, sorted, 0, 1);
+  sym->count = kept;
+  sym->strtab = desc->strtab;
+  kfree(sorted);
+}
+
+void elf_symbolizer_free(struct elf_symbolizer *sym) {
+  kfree(sym->syms);
+  sym->syms = nullptr;
+  sym->count = 0;
+}
+
+// Descends right whenever the node starts at or below addr; the last right
+// turn is the closest such symbol. Its position is k with the trailing left
+// turns and that right turn shifted out.
+const char *elf_symbolize(const struct elf_symbolizer *sym, u64 addr, u64 *offset) {
+  const struct elf_symbol *syms = sym->syms;
+  usize n = sym->count;
+  usize k = 1;
+  while (k <= n) {
+    __builtin_prefetch(syms + 4 * k);
+    k = 2 * k + (syms[k].start <= addr);
+  }
+  k >>= __builtin_ffsll(k);
+  if (k == 0) return nullptr;
+
+  // a trailing symbol with no size still covers its own address
+  u64 off = addr - syms[k].start;
+  if (off >= syms[k].size && off != 0) return nullptr;
+  if (offset) *offset = off;
+  return sym->strtab + syms[k].name;
+}
+
+// The SysV .hash function.
+static u32 sysv_hash(const char *name) {
+  u32 h = 0;
+  for (const u8 *p = (const u8 *)name; *p; p++) {
+    h = (h << 4) + *p;
+    u32 g = h & 0xf0000000;
+    if (g) h ^= g >> 24;
+    h &= ~g;
+  }
+  return h;
+}
+
+static bool named(const struct elf_sym *s, usize names) {
+  return s->st_name != 0 && s->st_name < names && s->st_shndx != SHN_UNDEF;
+}
+
+void elf_index_names(struct elf_desc *desc) {
+  usize total = symtab_count(desc);
+  usize names = names_size(desc, desc->sects.symtab);
+  usize n = 0;
+  for (usize i = 0; i < total; i++) {
+    if (named(&desc->symtab[i], names)) n++;
+  }
+
+  // at most half full, so probe runs stay short
+  usize cap = 16;
+  while (cap < 2 * n) cap *= 2;
+  desc->names.slots = (struct elf_name_slot *)kmalloc(cap * sizeof(struct elf_name_slot));
+  assert(desc->names.slots != nullptr, "Out of memory for name index");
+  memset(desc->names.slots, 0, cap * sizeof(struct elf_name_slot));
+  desc->names.mask = cap - 1;
+
+  for (usize i = 0; i < total; i++) {
+    const struct elf_sym *s = &desc->symtab[i];
+    if (!named(s, names)) continue;
+    const char *name = desc->strtab + s->st_name;
+    u32 h = elf_gnu_hash(name);
+    for (u32 j = h & desc->names.mask;; j = (j + 1) & desc->names.mask) {
+      struct elf_name_slot *slot = &desc->names.slots[j];
+      if (slot->index == 0) {
+        slot->hash = h;
+        slot->index = i + 1;
+        break;
+      }
+      const struct elf_sym *old = &desc->symtab[slot->index - 1];
+      if (slot->hash == h && strcmp(desc->strtab + old->st_name, name) == 0) {
+        if (ELF64_ST_BIND(s->st_info) == STB_GLOBAL && ELF64_ST_BIND(old->st_info) != STB_GLOBAL) {
+          slot->index = i + 1;
+        }
+        break;
+      }
+    }
+  }
+}
+
+void elf_free_names(struct elf_desc *desc) {
+  kfree(desc->names.slots);
+  desc->names.slots = nullptr;
+  desc->names.mask = 0;
+}
+
+// Header: nbuckets, symoffset, bloom_size, bloom_shift, then bloom_size
+// u64 bloom words, nbuckets u32 buckets and one u32 chain entry per symbol
+// from symoffset on. A chain entry holds the symbol's hash with bit 0 set
+// on the last entry of the bucket.
+static const struct elf_sym *find_gnu_hash(const struct elf_desc *desc, const char *name) {
+  // elf_parse kept the section only if it lies inside the image; the
+  // header's counts are checked against its size before any array is read
+  usize words = desc->sects.gnu_hash->sh_size / sizeof(u32);
+  if (words < 4) return nullptr;
+  const u32 *hdr = (const u32 *)(desc->raw_ptr + desc->sects.gnu_hash->sh_offset);
+  u32 nbuckets = hdr[0];
+  u32 symoffset = hdr[1];
+  u32 bloom_size = hdr[2];
+  u32 bloom_shift = hdr[3];
+  words -= 4;
+  if (nbuckets == 0 || bloom_size == 0 || bloom_size > words / 2 || nbuckets > words - 2 * bloom_size) {
+    return nullptr;
+  }
+  const u64 *bloom = (const u64 *)(hdr + 4);
+  const u32 *buckets = (const u32 *)(bloom + bloom_size);
+  const u32 *chain = buckets + nbuckets;
+  // chain entries present, and symbols they can describe
+  usize nchain = words - 2 * bloom_size - nbuckets;
+  usize nsyms = desc->sects.dynsym->sh_size / sizeof(struct elf_sym);
+  usize names = names_size(desc, desc->sects.dynsym);
+
+  u32 h = elf_gnu_hash(name);
+  u64 word = bloom[(h / 64) % bloom_size];
+  u64 mask = (1ULL << (h % 64)) | (1ULL << ((h >> bloom_shift) % 64));
+  if ((word & mask) != mask) return nullptr;
+
+  u32 i = buckets[h % nbuckets];
+  if (i < symoffset) return nullptr;
+  for (; i < nsyms && i - symoffset < nchain; i++) {
+    u32 h2 = chain[i - symoffset];
+    const struct elf_sym *s = &desc->dynsym[i];
+    if ((h | 1) == (h2 | 1) && named(s, names) && strcmp(desc->dynstr + s->st_name, name) == 0) {
+      return s;
+    }
+    if (h2 & 1) return nullptr;
+  }
+  return nullptr;
+}
+
+// Header: nbucket, nchain, then the bucket and chain arrays of symbol
+// indices, 0 ending a chain.
+static const struct elf_sym *find_sysv_hash(const struct elf_desc *desc, const char *name) {
+  usize words = desc->sects.hash->sh_size / sizeof(u32);
+  if (words < 2) return nullptr;
+  const u32 *hdr = (const u32 *)(desc->raw_ptr + desc->sects.hash->sh_offset);
+  u32 nbucket = hdr[0];
+  u32 nchain = hdr[1];
+  words -= 2;
+  if (nbucket == 0 || nbucket > words || nchain > words - nbucket) return nullptr;
+  const u32 *bucket = hdr + 2;
+  const u32 *chain = bucket + nbucket;
+  usize nsyms = desc->sects.dynsym->sh_size / sizeof(struct elf_sym);
+  usize names = names_size(desc, desc->sects.dynsym);
+  if (nchain > nsyms) nchain = nsyms;
+
+  // a well-formed chain visits each symbol at most once, so a longer walk
+  // is a loop
+  u32 steps = 0;
+  for (u32 i = bucket[sysv_hash(name) % nbucket]; i != 0 && i < nchain && steps++ < nchain; i = chain[i]) {
+    const struct elf_sym *s = &desc->dynsym[i];
+    if (named(s, names) && strcmp(desc->dynstr + s->st_name, name) == 0) {
+      return s;
+    }
+  }
+  return nullptr;
+}
+
+const struct elf_sym *elf_find_symbol(const struct elf_desc *desc, const char *name) {
+  if (desc->names.slots) {
+    u32 h = elf_gnu_hash(name);
+    for (u32 j = h & desc->names.mask; desc->names.slots[j].index; j = (j + 1) & desc->names.mask) {
+      const struct elf_name_slot *slot = &desc->names.slots[j];
+      const struct elf_sym *s = &desc->symtab[slot->index - 1];
+      if (slot->hash == h && strcmp(desc->strtab + s->st_name, name) == 0) {
+        return s;
+      }
+    }
+    // a stripped image has an empty index, but may still export the name
+    if (desc->sects.symtab) return nullptr;
+  }
+  if (desc->dynsym && desc->sects.gnu_hash) {
+    return find_gnu_hash(desc, name);
+  } else if (desc->dynsym && desc->sects.hash) {
+    return find_sysv_hash(desc, name);
+  }
+  return nullptr;
+}
@@ -1,215 +1,618 @@
 #include <klib/intx.h>
 #include <klib/string.h>
 #include <klib/assert.h>
+#include <klib/cpu.h>
 
-int bit_length(const u512& x) {
-  for (int i = NLIMBS_512 - 1; i >= 0; i--) {
-    if (x.limbs[i] != 0) {
-      int bits = 64 - __builtin_clzll(x.limbs[i]);
-      return i * 64 + bits;
+// Widest operand the limb-span kernels accept (4096 bits); sizes their
+// on-stack scratch.
+#define MAX_LIMBS 64
+
+// Operands at least this many limbs wide (and even) split with Karatsuba;
+// below it the quadratic kernels win on constant factors.
+#define KARATSUBA_THRESHOLD 32
+
+// Largest sliding window (16 odd powers) and the constant-time window (16
+// powers). Wide moduli get narrower windows so that an on-stack power table
+// never takes more than WINDOW_TABLE_BYTES of the kernel stack.
+#define MAX_WINDOW 5
+#define CT_WINDOW 4
+#define WINDOW_TABLE_BYTES 2048
+
+// Adds the 128-bit product p into the three-limb column accumulator.
+static inline void acc_add(u64& c0, u64& c1, u64& c2, u128 p) {
+  u128 t = (u128)c0 + (u64)p;
+  c0 = (u64)t;
+  t = (u128)c1 + (u64)(p >> 64) + (u64)(t >> 64);
+  c1 = (u64)t;
+  c2 += (u64)(t >> 64);
+}
+
+// Column-wise (comba) product: each output limb is finished in one pass
+// over its column, so r is written exactly once. r has 2n limbs.
+static void mul_comba(u64 *r, const u64 *a, const u64 *b, int n) {
+  u64 c0 = 0, c1 = 0, c2 = 0;
+  for (int k = 0; k < 2 * n - 1; k++) {
+    int lo = k < n ? 0 : k - n + 1;
+    int hi = k < n ? k : n - 1;
+    for (int i = lo; i <= hi; i++) {
+      acc_add(c0, c1, c2, (u128)a[i] * b[k - i]);
     }
+    r[k] = c0;
+    c0 = c1;
+    c1 = c2;
+    c2 = 0;
   }
-  return 0;
+  r[2 * n - 1] = c0;
 }
 
-int get_bit(const u512& x, int bit_index) {
-  int limb_index = bit_index / 64;
-  int shift = bit_index % 64;
-  return (x.limbs[limb_index] >> shift) & 1;
+// Comba squaring: every cross product a[i]*a[j], i < j, is computed once
+// and doubled, roughly halving the multiplies.
+static void sqr_comba(u64 *r, const u64 *a, int n) {
+  u64 c0 = 0, c1 = 0, c2 = 0;
+  for (int k = 0; k < 2 * n - 1; k++) {
+    int lo = k < n ? 0 : k - n + 1;
+    u64 d0 = 0, d1 = 0, d2 = 0;
+    for (int i = lo; i < k - i; i++) {
+      acc_add(d0, d1, d2, (u128)a[i] * a[k - i]);
+    }
+    d2 = (d2 << 1) | (d1 >> 63);
+    d1 = (d1 << 1) | (d0 >> 63);
+    d0 <<= 1;
+    if (!(k & 1)) {
+      acc_add(d0, d1, d2, (u128)a[k / 2] * a[k / 2]);
+    }
+    u128 t = (u128)c0 + d0;
+    c0 = (u64)t;
+    t = (u128)c1 + d1 + (u64)(t >> 64);
+    c1 = (u64)t;
+    c2 += d2 + (u64)(t >> 64);
+
+    r[k] = c0;
+    c0 = c1;
+    c1 = c2;
+    c2 = 0;
+  }
+  r[2 * n - 1] = c0;
+}
+
+// r[0..n) += a[0..n) * b; returns the limb carried out of r[n - 1]. Two
+// independent carry chains (adcx on CF for the low halves, adox on OF for
+// the high halves) let consecutive mulx results overlap in the pipeline.
+// The loop only uses lea/jrcxz so neither flag is disturbed between limbs.
+static u64 mul_add_row_adx(u64 *r, const u64 *a, usize n, u64 b) {
+  u64 carry;
+  asm volatile(
+    "xorl %%eax, %%eax\n\t"
+    "1:\n\t"
+    "mulxq (%[a]), %%r8, %%r9\n\t"
+    "movq (%[r]), %%r10\n\t"
+    "adcxq %%r8, %%r10\n\t"
+    "adoxq %%rax, %%r10\n\t"
+    "movq %%r10, (%[r])\n\t"
+    "movq %%r9, %%rax\n\t"
+    "leaq 8(%[a]), %[a]\n\t"
+    "leaq 8(%[r]), %[r]\n\t"
+    "leaq -1(%[n]), %[n]\n\t"
+    "jrcxz 2f\n\t"
+    "jmp 1b\n\t"
+    "2:\n\t"
+    "movl $0, %%r10d\n\t"
+    "adcxq %%r10, %%rax\n\t"
+    "adoxq %%r10, %%rax\n\t"
+    : "=&a"(carry), [a] "+r"(a), [r] "+r"(r), [n] "+c"(n)
+    : "d"(b)
+    : "r8", "r9", "r10", "cc", "memory");
+  return carry;
 }
 
-u512 operator+(const u512& x, const u512& y) {
-  u512 z;
-  u64 carry = 0;
-  for (int i = 0; i < NLIMBS_512; i++) {
-    z.limbs[i] = x.limbs[i] + y.limbs[i] + carry;
-    carry = (x.limbs[i] > ~y.limbs[i]);
+static void mul_adx(u64 *r, const u64 *a, const u64 *b, int n) {
+  for (int i = 0; i < n; i++) r[i] = 0;
+  for (int i = 0; i < n; i++) {
+    r[i + n] = mul_add_row_adx(r + i, a, n, b[i]);
   }
-  return z;
 }
 
-u512 operator-(const u512& x, const u512& y) {
-  u512 z;
+// With both carry chains in hardware a plain row multiply outruns comba
+// squaring, whose saving in multiplies is eaten by the 128-bit accumulator.
+static void sqr_adx(u64 *r, const u64 *a, int n) {
+  mul_adx(r, a, a, n);
+}
+
+static void mul_resolve(u64 *r, const u64 *a, const u64 *b, int n);
+static void sqr_resolve(u64 *r, const u64 *a, int n);
+static void (*mul_kernel)(u64 *, const u64 *, const u64 *, int) = mul_resolve;
+static void (*sqr_kernel)(u64 *, const u64 *, int) = sqr_resolve;
+
+static bool have_adx() {
+  const struct cpu_features *f = cpu_get_features();
+  return f->bmi2 && f->adx;
+}
+
+static void mul_resolve(u64 *r, const u64 *a, const u64 *b, int n) {
+  mul_kernel = have_adx() ? mul_adx : mul_comba;
+  mul_kernel(r, a, b, n);
+}
+
+static void sqr_resolve(u64 *r, const u64 *a, int n) {
+  sqr_kernel = have_adx() ? sqr_adx : sqr_comba;
+  sqr_kernel(r, a, n);
+}
+
+// r[0..n) = |a - b| over n limbs; returns true when a < b.
+static bool sub_abs(u64 *r, const u64 *a, const u64 *b, int n) {
+  bool neg = false;
+  for (int i = n - 1; i >= 0; i--) {
+    if (a[i] != b[i]) {
+      neg = a[i] < b[i];
+      break;
+    }
+  }
+  if (neg) {
+    const u64 *t = a;
+    a = b;
+    b = t;
+  }
   u64 borrow = 0;
-  for (int i = 0; i < NLIMBS_512; i++) {
-    z.limbs[i] = x.limbs[i] - y.limbs[i] - borrow;
-    borrow = (x.limbs[i] < y.limbs[i]);
+  for (int i = 0; i < n; i++) {
+    borrow = intx::sub_with_borrow(a[i], b[i], borrow, &r[i]);
   }
-  return z;
+  return neg;
 }
 
-u512 operator*(const u512& x, const u512& y) {
-  u512 z;
-  for (int i = 0; i < NLIMBS_512; i++) {
-    u64 carry = 0;
-    for (int j = 0; j < NLIMBS_512 - i; j++) {
-      u128 t = (u128)x.limbs[i] * y.limbs[j] + z.limbs[i + j] + carry;
-      z.limbs[i + j] = (u64)t;
-      carry = (u64)(t >> 64);
-    }
+// r[0..n) += a[0..m), m <= n, propagating the carry; returns the carry out.
+static u64 add_into(u64 *r, int n, const u64 *a, int m) {
+  u64 c = 0;
+  for (int i = 0; i < m; i++) {
+    c = intx::add_with_carry(r[i], a[i], c, &r[i]);
+  }
+  for (int i = m; i < n && c; i++) {
+    c = intx::add_with_carry(r[i], 0, c, &r[i]);
   }
-  return z;
+  return c;
 }
 
-u512 operator<<(const u512& x, int n) {
-  u512 z;
-  int k = n / 64;
-  int s = n % 64;
-  for (int i = 0; i < NLIMBS_512; i++) {
-    if (i + k < NLIMBS_512) {
-      z.limbs[i + k] = x.limbs[i] << s;
-      if (s && i + k + 1 < NLIMBS_512) {
-        z.limbs[i + k + 1] |= x.limbs[i] >> (64 - s);
-      }
-    }
+static u64 sub_into(u64 *r, int n, const u64 *a, int m) {
+  u64 b = 0;
+  for (int i = 0; i < m; i++) {
+    b = intx::sub_with_borrow(r[i], a[i], b, &r[i]);
+  }
+  for (int i = m; i < n && b; i++) {
+    b = intx::sub_with_borrow(r[i], 0, b, &r[i]);
   }
-  return z;
+  return b;
 }
 
-u512 operator>>(const u512& x, int n) {
-  u512 z;
-  int k = n / 64;
-  int s = n % 64;
-  for (int i = 0; i < NLIMBS_512; i++) {
-    if (i >= k) {
-      z.limbs[i - k] = x.limbs[i] >> s;
-      if (s && i - k - 1 >= 0) {
-        z.limbs[i - k - 1] |= x.limbs[i] << (64 - s);
-      }
-    }
+static void mul_karatsuba(u64 *r, const u64 *a, const u64 *b, int n);
+
+static void mul_limbs(u64 *r, const u64 *a, const u64 *b, int n) {
+  if (n >= KARATSUBA_THRESHOLD && !(n & 1)) {
+    mul_karatsuba(r, a, b, n);
+  } else {
+    mul_kernel(r, a, b, n);
   }
-  return z;
 }
 
-u512 operator|(const u512& x, const u512 &y) {
-  u512 r;
-  for (int i=0;i<NLIMBS_512;i++) {
-    r.limbs[i] = x.limbs[i] | y.limbs[i];
+// a*b = z2*B^2h + (z0 + z2 - (a0 - a1)(b0 - b1))*B^h + z0 with B^h the
+// half-width base; three half-size products instead of four.
+static void mul_karatsuba(u64 *r, const u64 *a, const u64 *b, int n) {
+  int h = n / 2;
+  u64 da[MAX_LIMBS / 2], db[MAX_LIMBS / 2];
+  u64 mid[MAX_LIMBS + 1];
+  u64 t[MAX_LIMBS];
+
+  mul_limbs(r, a, b, h);
+  mul_limbs(r + 2 * h, a + h, b + h, h);
+
+  bool na = sub_abs(da, a, a + h, h);
+  bool nb = sub_abs(db, b, b + h, h);
+  mul_limbs(t, da, db, h);
+
+  for (int i = 0; i < 2 * h; i++) mid[i] = r[i];
+  mid[2 * h] = 0;
+  add_into(mid, 2 * h + 1, r + 2 * h, 2 * h);
+  if (na == nb) {
+    sub_into(mid, 2 * h + 1, t, 2 * h);
+  } else {
+    add_into(mid, 2 * h + 1, t, 2 * h);
   }
-  return r;
+  add_into(r + h, n + h, mid, 2 * h + 1);
 }
 
-u512 operator/(const u512& dividend, const u512& divisor) {
-  assert(!(divisor == 0), "Division by zero");
+static void sqr_limbs(u64 *r, const u64 *a, int n) {
+  if (n >= KARATSUBA_THRESHOLD && !(n & 1)) {
+    mul_karatsuba(r, a, a, n);
+  } else {
+    sqr_kernel(r, a, n);
+  }
+}
 
-  u512 quotient = {0};
-  u512 remainder = {0};
+void intx::mul_wide(u64 *r, const u64 *a, const u64 *b, usize n) {
+  assert(n <= MAX_LIMBS, "Operand too wide");
+  mul_limbs(r, a, b, n);
+}
 
-  // long division implementation
-  for (int i = 511; i >= 0; i--) {
-    remainder = remainder << 1;
-    if (get_bit(dividend, i) == 1) {
-      remainder = remainder + 1;
-    }
-    if (remainder >= divisor) {
-      remainder = remainder - divisor;
-      quotient = quotient | (u512(1) << i);
-    }
+void intx::sqr_wide(u64 *r, const u64 *a, usize n) {
+  assert(n <= MAX_LIMBS, "Operand too wide");
+  sqr_limbs(r, a, n);
+}
+
+template<usize L>
+void uint_t<L>::mul_wide(const uint_t& x, const uint_t& y, uint_t& lo, uint_t& hi) {
+  u64 r[2 * L];
+  mul_limbs(r, x.limbs, y.limbs, L);
+  for (usize i = 0; i < L; i++) {
+    lo.limbs[i] = r[i];
+    hi.limbs[i] = r[i + L];
+  }
+}
+
+template<usize L>
+void uint_t<L>::sqr_wide(const uint_t& x, uint_t& lo, uint_t& hi) {
+  u64 r[2 * L];
+  sqr_limbs(r, x.limbs, L);
+  for (usize i = 0; i < L; i++) {
+    lo.limbs[i] = r[i];
+    hi.limbs[i] = r[i + L];
   }
-  return quotient;
 }
 
-u512 operator%(const u512& x, const u512& y) {
-  return x - (x / y) * y;
+static inline u64 div_2by1(u64 hi, u64 lo, u64 d, u64 *rem) {
+  u64 q;
+  asm("divq %4" : "=a"(q), "=d"(*rem) : "a"(lo), "d"(hi), "rm"(d));
+  return q;
 }
 
-u512 u512::expmod(const u512& x, const u512& y, const u512& m) {
-  if (m == 1) return 0;
-  u512 r = 1;
-  u512 base = x % m;
-  u512 e = y;
-  while (e > 0) {
-    if (e % 2 == 1) {
-      r = (r * base) % m;
-    }
-    e = e >> 1;
-    base = (base * base) % m;
+u64 intx::div_small(u64 *x, usize n, u64 d) {
+  u64 rem = 0;
+  for (usize i = n; i-- > 0;) {
+    x[i] = div_2by1(rem, x[i], d, &rem);
   }
-  return r;
+  return rem;
 }
 
-bool operator<(const u512& x, const u512& y) {
-  for (int i = NLIMBS_512 - 1; i >= 0; i--) {
-    if (x.limbs[i] < y.limbs[i]) {
-      return true;
-    }
-    if (x.limbs[i] > y.limbs[i]) {
-      return false;
+static int limb_count(const u64 *x, int n) {
+  while (n > 0 && x[n - 1] == 0) n--;
+  return n;
+}
+
+// Knuth's Algorithm D (TAOCP 4.3.1). u has m limbs, v has n significant
+// limbs with m >= n >= 1. Writes the m - n + 1 quotient limbs to q and the
+// n remainder limbs to r; either may be null.
+static void divmod_limbs(u64 *q, u64 *r, const u64 *u, int m, const u64 *v, int n) {
+  if (n == 1) {
+    u64 rem = 0;
+    for (int j = m - 1; j >= 0; j--) {
+      u64 qj = div_2by1(rem, u[j], v[0], &rem);
+      if (q) q[j] = qj;
     }
+    if (r) r[0] = rem;
+    return;
   }
-  return false;
-}
 
-bool operator>(const u512& x, const u512& y) {
-  for (int i = NLIMBS_512 - 1; i >= 0; i--) {
-    if (x.limbs[i] > y.limbs[i]) {
-      return true;
+  // normalize so the divisor's top bit is set; this bounds qhat to at most
+  // two too large
+  u64 un[2 * MAX_LIMBS + 1];
+  u64 vn[MAX_LIMBS];
+  int s = __builtin_clzll(v[n - 1]);
+  for (int i = n - 1; i > 0; i--) {
+    vn[i] = s ? (v[i] << s) | (v[i - 1] >> (64 - s)) : v[i];
+  }
+  vn[0] = v[0] << s;
+  un[m] = s ? u[m - 1] >> (64 - s) : 0;
+  for (int i = m - 1; i > 0; i--) {
+    un[i] = s ? (u[i] << s) | (u[i - 1] >> (64 - s)) : u[i];
+  }
+  un[0] = u[0] << s;
+
+  u64 vtop = vn[n - 1];
+  u64 vnext = vn[n - 2];
+  for (int j = m - n; j >= 0; j--) {
+    u64 qhat, rhat;
+    bool rhat_big = false;
+    if (un[j + n] >= vtop) {
+      qhat = ~0ULL;
+      rhat = un[j + n - 1] + vtop;
+      rhat_big = rhat < vtop;
+    } else {
+      qhat = div_2by1(un[j + n], un[j + n - 1], vtop, &rhat);
+    }
+    while (!rhat_big && (u128)qhat * vnext > (((u128)rhat << 64) | un[j + n - 2])) {
+      qhat--;
+      rhat += vtop;
+      rhat_big = rhat < vtop;
     }
-    if (x.limbs[i] < y.limbs[i]) {
-      return false;
+
+    // un[j..j+n] -= qhat * vn
+    u64 k = 0;
+    for (int i = 0; i < n; i++) {
+      u128 p = (u128)qhat * vn[i];
+      u64 plo = (u64)p;
+      u64 t = un[i + j] - plo;
+      u64 b = un[i + j] < plo;
+      un[i + j] = t - k;
+      k = (u64)(p >> 64) + b + (t < k);
+    }
+    u64 top = un[j + n];
+    un[j + n] = top - k;
+
+    if (top < k) {
+      // qhat was one too large: add the divisor back
+      qhat--;
+      u64 c = 0;
+      for (int i = 0; i < n; i++) {
+        c = intx::add_with_carry(un[i + j], vn[i], c, &un[i + j]);
+      }
+      un[j + n] += c;
+    }
+    if (q) q[j] = qhat;
+  }
+
+  if (r) {
+    for (int i = 0; i < n; i++) {
+      r[i] = s ? (un[i] >> s) | (un[i + 1] << (64 - s)) : un[i];
     }
   }
-  return false;
 }
 
-bool operator<=(const u512& x, const u512& y) {
-  return !(x > y);
+template<usize L>
+void uint_t<L>::divmod(const uint_t& x, const uint_t& y, uint_t& q, uint_t& r) {
+  int n = limb_count(y.limbs, L);
+  assert(n != 0, "Division by zero");
+  int m = limb_count(x.limbs, L);
+
+  uint_t quot, rem;
+  if (m < n) {
+    rem = x;
+  } else {
+    divmod_limbs(quot.limbs, rem.limbs, x.limbs, m, y.limbs, n);
+  }
+  q = quot;
+  r = rem;
 }
 
-bool operator>=(const u512& x, const u512& y) {
-  return !(x < y);
+// -m0^-1 mod 2^64 by Newton iteration; each step doubles the correct bits
+// starting from the 3 that x = m0 already gets right for odd m0.
+static u64 mont_n0(u64 m0) {
+  u64 inv = m0;
+  for (int i = 0; i < 5; i++) {
+    inv *= 2 - m0 * inv;
+  }
+  return -inv;
+}
+
+// r = t mod m for the n + 1 limb CIOS result t < 2m: subtracts m once if
+// t >= m, selecting by mask so the timing does not depend on whether the
+// subtraction was needed.
+template<int n>
+static inline void mont_final_sub(u64 *r, const u64 *t, const u64 *m) {
+  u64 d[n];
+  u64 borrow = intx::sub_n<n>(d, t, m);
+  u64 keep_t = 0 - (u64)(borrow > t[n]);
+  for (int i = 0; i < n; i++) {
+    r[i] = (t[i] & keep_t) | (d[i] & ~keep_t);
+  }
 }
 
-bool operator==(const u512& x, const u512& y) {
-  for (int i = 0; i < NLIMBS_512; i++) {
-    if (x.limbs[i] != y.limbs[i]) {
-      return false;
+// r = a * b * 2^(-64n) mod m using coarsely integrated operand scanning
+// (CIOS). a, b < m; r may alias a or b.
+template<int n>
+static void mont_mul_cios(u64 *r, const u64 *a, const u64 *b, const u64 *m, u64 n0) {
+  u64 t[n + 2] = {0};
+  for (int i = 0; i < n; i++) {
+    u64 carry = 0;
+    for (int j = 0; j < n; j++) {
+      u128 s = (u128)a[j] * b[i] + t[j] + carry;
+      t[j] = (u64)s;
+      carry = (u64)(s >> 64);
+    }
+    u128 s = (u128)t[n] + carry;
+    t[n] = (u64)s;
+    t[n + 1] = (u64)(s >> 64);
+
+    u64 q = t[0] * n0;
+    s = (u128)q * m[0] + t[0];
+    carry = (u64)(s >> 64);
+    for (int j = 1; j < n; j++) {
+      s = (u128)q * m[j] + t[j] + carry;
+      t[j - 1] = (u64)s;
+      carry = (u64)(s >> 64);
     }
+    s = (u128)t[n] + carry;
+    t[n - 1] = (u64)s;
+    t[n] = t[n + 1] + (u64)(s >> 64);
   }
-  return true;
+  mont_final_sub<n>(r, t, m);
 }
 
-bool operator!=(const u512& x, const u512& y) {
-  return !(x == y);
+template<usize L>
+Montgomery<L>::Montgomery(const value_type& mod) : m(mod) {
+  assert(mod.limbs[0] & 1, "Montgomery modulus must be odd");
+  n0 = mont_n0(mod.limbs[0]);
+
+  // R mod m: R - m is congruent to R, and fits in L limbs
+  value_type neg;
+  neg -= mod;
+  one = neg % mod;
+
+  // R^2 mod m as (R mod m)^2 through one double-width reduction
+  r2 = value_type::mulmod(one, one, mod);
+}
+
+template<usize L>
+uint_t<L> Montgomery<L>::mul(const value_type& a, const value_type& b) const {
+  value_type r;
+  mont_mul_cios<L>(r.limbs, a.limbs, b.limbs, m.limbs, n0);
+  return r;
+}
+
+template<usize L>
+uint_t<L> Montgomery<L>::to_mont(const value_type& x) const {
+  return mul(x, r2);
 }
 
-u512::u512() {
-  for (int i = 0; i < 8; i++) {
-    limbs[i] = 0;
+template<usize L>
+uint_t<L> Montgomery<L>::from_mont(const value_type& x) const {
+  return mul(x, value_type(1));
+}
+
+// Width of the exponent window: wider windows save multiplies on long
+// exponents but the table costs 2^(w-1) multiplies to build.
+static int window_bits(int bits) {
+  if (bits > 239) return 5;
+  if (bits > 79) return 4;
+  if (bits > 23) return 3;
+  return 1;
+}
+
+// Widest window up to max whose table of 2^(w - shift) L-limb entries fits
+// in WINDOW_TABLE_BYTES.
+template<usize L>
+static constexpr int window_cap(int max, int shift) {
+  int w = max;
+  while (w > 1 && ((usize)1 << (w - shift)) * L * 8 > WINDOW_TABLE_BYTES) w--;
+  return w;
+}
+
+// w exponent bits starting at bit pos, which may straddle two limbs.
+template<usize L>
+static u64 window_at(const uint_t<L>& e, int pos, int w) {
+  usize limb = pos / 64;
+  int shift = pos % 64;
+  u64 v = e.limbs[limb] >> shift;
+  if (shift + w > 64 && limb + 1 < L) {
+    v |= e.limbs[limb + 1] << (64 - shift);
   }
+  return v & ((1ULL << w) - 1);
 }
 
-template<typename T>
-u512::u512(T value) {
-  static_assert(sizeof(T) <= 8, "T must be at most 64 bits");
+// Left-to-right sliding window over a table of odd powers base^1, base^3,
+// ..., base^(2^w - 1). Every window ends in a set bit, so runs of zeros
+// cost only squarings. The accumulator is multiplied in place throughout.
+template<usize L>
+uint_t<L> Montgomery<L>::exp(const value_type& base, const value_type& e) const {
+  int bits = e.bit_length();
+  if (bits == 0) return one;
+  constexpr int max_w = window_cap<L>(MAX_WINDOW, 1);
+  int w = window_bits(bits);
+  if (w > max_w) w = max_w;
 
-  for (int i = 0; i < 8; i++) {
-    limbs[i] = 0;
+  value_type table[1 << (max_w - 1)];
+  table[0] = base;
+  if (w > 1) {
+    value_type sq = mul(base, base);
+    for (int i = 1; i < 1 << (w - 1); i++) {
+      table[i] = mul(table[i - 1], sq);
+    }
   }
 
-  for (usize i = 0; i < sizeof(T); i++) {
-    limbs[i / 8] |= (static_cast<u64>(value) & 0xFF) << (8 * (i % 8));
-    value >>= 8;
+  value_type r = one;
+  bool started = false;
+  int i = bits - 1;
+  while (i >= 0) {
+    if (!e.bit(i)) {
+      mont_mul_cios<L>(r.limbs, r.limbs, r.limbs, m.limbs, n0);
+      i--;
+      continue;
+    }
+    int j = i - w + 1 < 0 ? 0 : i - w + 1;
+    while (!e.bit(j)) j++;
+    u64 val = window_at(e, j, i - j + 1);
+    if (started) {
+      for (int k = j; k <= i; k++) {
+        mont_mul_cios<L>(r.limbs, r.limbs, r.limbs, m.limbs, n0);
+      }
+      mont_mul_cios<L>(r.limbs, r.limbs, table[val >> 1].limbs, m.limbs, n0);
+    } else {
+      r = table[val >> 1];
+      started = true;
+    }
+    i = j - 1;
   }
+  return r;
 }
-template u512::u512(u8);
-template u512::u512(u16);
-template u512::u512(u32);
-template u512::u512(u64);
-template u512::u512<int>(int);
-template u512::u512<long>(long);
-template u512::u512<long long>(long long);
 
-u512::u512(u128 v) {
-  limbs[0] = (u64)v;
-  limbs[1] = (u64)(v >> 64);
+// Fixed 4-bit windows (narrower for wide moduli) over the exponent's full
+// width: the sequence of squarings and multiplies is the same for every
+// exponent, and each table lookup reads every entry and keeps one by mask,
+// so neither the timing nor the cache lines touched depend on the exponent
+// bits.
+template<usize L>
+uint_t<L> Montgomery<L>::exp_consttime(const value_type& base, const value_type& e) const {
+  constexpr int w = window_cap<L>(CT_WINDOW, 0);
+  value_type table[1 << w];
+  table[0] = one;
+  table[1] = base;
+  for (int i = 2; i < 1 << w; i++) {
+    table[i] = mul(table[i - 1], base);
+  }
+
+  value_type r = one;
+  // the top window may reach past the last limb when w does not divide it
+  for (int pos = ((int)(L * 64) - 1) / w * w; pos >= 0; pos -= w) {
+    for (int k = 0; k < w; k++) {
+      mont_mul_cios<L>(r.limbs, r.limbs, r.limbs, m.limbs, n0);
+    }
+    u64 idx = window_at(e, pos, w);
+    value_type x;
+    for (u64 i = 0; i < 1 << w; i++) {
+      u64 mask = 0 - (((i ^ idx) - 1) >> 63);
+      for (usize j = 0; j < L; j++) {
+        x.limbs[j] |= table[i].limbs[j] & mask;
+      }
+    }
+    mont_mul_cios<L>(r.limbs, r.limbs, x.limbs, m.limbs, n0);
+  }
+  return r;
 }
 
-u512 u512::from_hex(const char* hex) {
-  u512 x = {0};
+// Reduces the plen-limb product p modulo m with Algorithm D, so no bits of
+// the double-width product are lost.
+template<usize L>
+static uint_t<L> reduce_wide(const u64 *p, int plen, const uint_t<L>& m) {
+  int n = limb_count(m.limbs, L);
+  int len = limb_count(p, plen);
+  uint_t<L> r;
+  if (len < n) {
+    for (int i = 0; i < len; i++) r.limbs[i] = p[i];
+  } else {
+    divmod_limbs(nullptr, r.limbs, p, len, m.limbs, n);
+  }
+  return r;
+}
+
+template<usize L>
+uint_t<L> uint_t<L>::mulmod(const uint_t& a, const uint_t& b, const uint_t& m) {
+  u64 p[2 * L];
+  mul_limbs(p, a.limbs, b.limbs, L);
+  return reduce_wide(p, 2 * L, m);
+}
+
+template<usize L>
+uint_t<L> uint_t<L>::expmod(const uint_t& x, const uint_t& y, const uint_t& m) {
+  if (m == 1) return 0;
+  if (m.limbs[0] & 1) {
+    Montgomery<L> ctx(m);
+    return ctx.from_mont(ctx.exp(ctx.to_mont(x % m), y));
+  }
+  uint_t r = 1;
+  uint_t base = x % m;
+  u64 p[2 * L];
+  for (int i = y.bit_length() - 1; i >= 0; i--) {
+    sqr_limbs(p, r.limbs, L);
+    r = reduce_wide(p, 2 * L, m);
+    if (y.bit(i)) {
+      r = mulmod(r, base, m);
+    }
+  }
+  return r;
+}
+
+template<usize L>
+uint_t<L> uint_t<L>::from_hex(const char* hex) {
+  uint_t x;
 
   for (int i = 0; hex[i] != '\0'; i++) {
-    for (int j = NLIMBS_512 - 1; j > 0; j--) {
+    for (int j = L - 1; j > 0; j--) {
       x.limbs[j] = (x.limbs[j] << 4) | (x.limbs[j-1] >> 60);
     }
     x.limbs[0] <<= 4;
@@ -227,20 +630,29 @@ u512 u512::from_hex(const char* hex) {
   return x;
 }
 
-
-u512 u512::from_dec(const char *s) {
-  u512 x;
-  int len = strlen(s);
-  for (int i = 0; i < len; i++) {
-    x = x * 10;
-    x.limbs[0] += s[i] - '0';
+// Digits are taken 19 at a time, the most that fit a limb, so each chunk
+// costs one single-limb multiply-accumulate over the value.
+template<usize L>
+uint_t<L> uint_t<L>::from_dec(const char *s) {
+  uint_t x;
+  while (*s >= '0' && *s <= '9') {
+    u64 chunk = 0;
+    u64 scale = 1;
+    for (int i = 0; i < INTX_DEC_CHUNK && *s >= '0' && *s <= '9'; i++, s++) {
+      chunk = chunk * 10 + (*s - '0');
+      scale *= 10;
+    }
+    x.mul_small(scale, chunk);
   }
   return x;
 }
 
-u512 operator""_u512(const char *s) {
-  if (s[0] == '0' && s[1] == 'x') {
-    return u512::from_hex(s+2);
-  }
-  return u512::from_dec(s);
-}
+#define INSTANTIATE_UINT(L) \
+  template class uint_t<L>; \
+  template class Montgomery<L>;
+
+INSTANTIATE_UINT(4)
+INSTANTIATE_UINT(8)
+INSTANTIATE_UINT(16)
+INSTANTIATE_UINT(32)
+INSTANTIATE_UINT(64)
@@ -1,45 +1,355 @@
 #include <klib/string.h>
+#include <klib/cpu.h>
 
-extern "C" {
-void *memcpy(void *dest, const void *src, u32 n) {
-    u8 *pdest = (u8 *)dest;
-    const u8 *psrc = (const u8 *)src;
- 
-    for (u32 i = 0; i < n; i++) {
-        pdest[i] = psrc[i];
+// Unaligned-tolerant word access; x86 handles misaligned loads natively and
+// the may_alias attribute keeps the compiler from assuming type punning UB.
+typedef u64 __attribute__((__may_alias__, __aligned__(1))) u64_ua;
+
+// Sizes at or above this go to the string instructions; below it the
+// microcode startup cost of rep movs/stos outweighs the word loop.
+#define REP_THRESHOLD 512
+
+// With FSRM, rep movsb is competitive from this size on.
+#define FSRM_THRESHOLD 64
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+// Which bulk-move strategy a memcpy/memset/memmove variant is built with.
+enum copy_mode {
+    COPY_WORDS, // word loop, rep movsq/stosq for large sizes
+    COPY_ERMS,  // word loop, rep movsb/stosb for large sizes
+    COPY_FSRM   // rep movsb for everything but tiny copies
+};
+
+template<copy_mode M>
+static ALWAYS_INLINE void copy_fwd(u8 *d, const u8 *s, usize n) {
+    if (M == COPY_FSRM && n >= FSRM_THRESHOLD) {
+        asm volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+        return;
     }
- 
+    if (n >= 8) {
+        // align the destination so every store is a single aligned write
+        usize head = (-(usize)d) & 7;
+        for (usize i = 0; i < head; i++) *d++ = *s++;
+        n -= head;
+
+        if (n >= REP_THRESHOLD) {
+            if (M != COPY_WORDS) {
+                asm volatile("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+                return;
+            }
+            usize q = n >> 3;
+            asm volatile("rep movsq" : "+D"(d), "+S"(s), "+c"(q) : : "memory");
+            n &= 7;
+        } else {
+            while (n >= 32) {
+                u64 a = ((const u64_ua *)s)[0];
+                u64 b = ((const u64_ua *)s)[1];
+                u64 c = ((const u64_ua *)s)[2];
+                u64 e = ((const u64_ua *)s)[3];
+                ((u64 *)d)[0] = a;
+                ((u64 *)d)[1] = b;
+                ((u64 *)d)[2] = c;
+                ((u64 *)d)[3] = e;
+                d += 32; s += 32; n -= 32;
+            }
+            while (n >= 8) {
+                *(u64 *)d = *(const u64_ua *)s;
+                d += 8; s += 8; n -= 8;
+            }
+        }
+    }
+    while (n--) *d++ = *s++;
+}
+
+static inline void copy_bwd(u8 *d, const u8 *s, usize n) {
+    d += n;
+    s += n;
+    if (n >= 8) {
+        usize tail = (usize)d & 7;
+        for (usize i = 0; i < tail; i++) *--d = *--s;
+        n -= tail;
+        while (n >= 32) {
+            d -= 32; s -= 32; n -= 32;
+            u64 a = ((const u64_ua *)s)[3];
+            u64 b = ((const u64_ua *)s)[2];
+            u64 c = ((const u64_ua *)s)[1];
+            u64 e = ((const u64_ua *)s)[0];
+            ((u64 *)d)[3] = a;
+            ((u64 *)d)[2] = b;
+            ((u64 *)d)[1] = c;
+            ((u64 *)d)[0] = e;
+        }
+        while (n >= 8) {
+            d -= 8; s -= 8; n -= 8;
+            *(u64 *)d = *(const u64_ua *)s;
+        }
+    }
+    while (n--) *--d = *--s;
+}
+
+template<copy_mode M>
+static void *memcpy_variant(void *dest, const void *src, usize n) {
+    copy_fwd<M>((u8 *)dest, (const u8 *)src, n);
     return dest;
 }
-void *memset(void *s, int c, u32 n) {
+
+template<copy_mode M>
+static void *memset_variant(void *s, int c, usize n) {
     u8 *p = (u8 *)s;
-    for (u32 i = 0; i < n; i++) {
-        p[i] = (u8)c;
+    u64 v = (u64)(u8)c * 0x0101010101010101ULL;
+    if (n >= 8) {
+        usize head = (-(usize)p) & 7;
+        for (usize i = 0; i < head; i++) *p++ = (u8)c;
+        n -= head;
+
+        if (n >= REP_THRESHOLD) {
+            if (M != COPY_WORDS) {
+                asm volatile("rep stosb" : "+D"(p), "+c"(n) : "a"(v) : "memory");
+                return s;
+            }
+            usize q = n >> 3;
+            asm volatile("rep stosq" : "+D"(p), "+c"(q) : "a"(v) : "memory");
+            n &= 7;
+        } else {
+            while (n >= 32) {
+                ((u64 *)p)[0] = v;
+                ((u64 *)p)[1] = v;
+                ((u64 *)p)[2] = v;
+                ((u64 *)p)[3] = v;
+                p += 32; n -= 32;
+            }
+            while (n >= 8) {
+                *(u64 *)p = v;
+                p += 8; n -= 8;
+            }
+        }
     }
+    while (n--) *p++ = (u8)c;
     return s;
 }
-void *memmove(void *dest, const void *src, u32 n) {
+
+template<copy_mode M>
+static void *memmove_variant(void *dest, const void *src, usize n) {
     u8 *pdest = (u8 *)dest;
     const u8 *psrc = (const u8 *)src;
- 
-    if (src > dest) {
-        for (u32 i = 0; i < n; i++) {
-            pdest[i] = psrc[i];
-        }
-    } else if (src < dest) {
-        for (u32 i = n; i > 0; i--) {
-            pdest[i-1] = psrc[i-1];
-        }
+
+    // a forward copy is safe unless dest lands inside [src, src + n)
+    if ((usize)(pdest - psrc) >= n) {
+        copy_fwd<M>(pdest, psrc, n);
+    } else if (pdest != psrc) {
+        copy_bwd(pdest, psrc, n);
     }
- 
+
     return dest;
 }
-u32 strlen(const char *str) {
-    u32 len = 0;
-    while (str[len]) {
-        len++;
+
+// SWAR helpers: HAS_ZERO is non-zero iff some byte of x is zero, and its
+// lowest set bit marks the first such byte (higher bits may be spurious).
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define HAS_ZERO(x) (((x) - ONES) & ~(x) & HIGHS)
+
+// True when an unaligned 8-byte load at p stays inside p's page, so string
+// scans can read ahead of the terminator without risking a fault.
+#define WORD_SAFE(p) (((usize)(p) & 4095) <= 4096 - 8)
+
+// Ordering of the first byte flagged in m (little-endian word order).
+static ALWAYS_INLINE int diff_byte(u64 x, u64 y, u64 m) {
+    u32 shift = __builtin_ctzll(m) & ~7u;
+    return (int)((x >> shift) & 0xff) - (int)((y >> shift) & 0xff);
+}
+
+static ALWAYS_INLINE usize strlen_body(const char *str) {
+    const char *p = str;
+    while ((usize)p & 7) {
+        if (!*p) return p - str;
+        p++;
+    }
+    // an aligned 8-byte load never crosses a page, so reading past the
+    // terminator inside the final word is safe
+    const u64 *w = (const u64 *)p;
+    u64 m;
+    while (!(m = HAS_ZERO(*w))) w++;
+    return (const char *)w + (__builtin_ctzll(m) >> 3) - str;
+}
+
+static ALWAYS_INLINE int memcmp_body(const void *ptr1, const void *ptr2, usize n) {
+    const u8 *a = (const u8 *)ptr1;
+    const u8 *b = (const u8 *)ptr2;
+    while (n >= 8) {
+        u64 x = *(const u64_ua *)a;
+        u64 y = *(const u64_ua *)b;
+        if (x != y) return diff_byte(x, y, x ^ y);
+        a += 8; b += 8; n -= 8;
+    }
+    while (n--) {
+        if (*a != *b) return *a - *b;
+        a++; b++;
+    }
+    return 0;
+}
+
+// Same SWAR code, but compiled so the compiler can use tzcnt/andn/shrx.
+static usize strlen_swar(const char *str) {
+    return strlen_body(str);
+}
+
+__attribute__((target("bmi,bmi2")))
+static usize strlen_bmi2(const char *str) {
+    return strlen_body(str);
+}
+
+static int memcmp_swar(const void *ptr1, const void *ptr2, usize n) {
+    return memcmp_body(ptr1, ptr2, n);
+}
+
+__attribute__((target("bmi,bmi2")))
+static int memcmp_bmi2(const void *ptr1, const void *ptr2, usize n) {
+    return memcmp_body(ptr1, ptr2, n);
+}
+
+// Until string_dispatch_init() runs, every slot points at a resolver that
+// performs the selection on first use and then forwards the call.
+static void *memcpy_resolve(void *dest, const void *src, usize n);
+static void *memset_resolve(void *s, int c, usize n);
+static void *memmove_resolve(void *dest, const void *src, usize n);
+static int memcmp_resolve(const void *ptr1, const void *ptr2, usize n);
+static usize strlen_resolve(const char *str);
+
+static void *(*memcpy_impl)(void *, const void *, usize) = memcpy_resolve;
+static void *(*memset_impl)(void *, int, usize) = memset_resolve;
+static void *(*memmove_impl)(void *, const void *, usize) = memmove_resolve;
+static int (*memcmp_impl)(const void *, const void *, usize) = memcmp_resolve;
+static usize (*strlen_impl)(const char *) = strlen_resolve;
+
+static struct string_dispatch dispatch = {"unset", "unset", "unset", "unset", "unset"};
+
+static void *memcpy_resolve(void *dest, const void *src, usize n) {
+    string_dispatch_init();
+    return memcpy_impl(dest, src, n);
+}
+
+static void *memset_resolve(void *s, int c, usize n) {
+    string_dispatch_init();
+    return memset_impl(s, c, n);
+}
+
+static void *memmove_resolve(void *dest, const void *src, usize n) {
+    string_dispatch_init();
+    return memmove_impl(dest, src, n);
+}
+
+static int memcmp_resolve(const void *ptr1, const void *ptr2, usize n) {
+    string_dispatch_init();
+    return memcmp_impl(ptr1, ptr2, n);
+}
+
+static usize strlen_resolve(const char *str) {
+    string_dispatch_init();
+    return strlen_impl(str);
+}
+
+extern "C" {
+const struct string_dispatch *string_dispatch_init() {
+    const struct cpu_features *f = cpu_get_features();
+
+    if (f->fsrm) {
+        memcpy_impl = memcpy_variant<COPY_FSRM>;
+        memmove_impl = memmove_variant<COPY_FSRM>;
+        dispatch.memcpy = dispatch.memmove = "fsrm";
+    } else if (f->erms) {
+        memcpy_impl = memcpy_variant<COPY_ERMS>;
+        memmove_impl = memmove_variant<COPY_ERMS>;
+        dispatch.memcpy = dispatch.memmove = "erms";
+    } else {
+        memcpy_impl = memcpy_variant<COPY_WORDS>;
+        memmove_impl = memmove_variant<COPY_WORDS>;
+        dispatch.memcpy = dispatch.memmove = "words";
+    }
+
+    if (f->erms) {
+        memset_impl = memset_variant<COPY_ERMS>;
+        dispatch.memset = "erms";
+    } else {
+        memset_impl = memset_variant<COPY_WORDS>;
+        dispatch.memset = "words";
+    }
+
+    if (f->bmi1 && f->bmi2) {
+        memcmp_impl = memcmp_bmi2;
+        strlen_impl = strlen_bmi2;
+        dispatch.memcmp = dispatch.strlen = "bmi2";
+    } else {
+        memcmp_impl = memcmp_swar;
+        strlen_impl = strlen_swar;
+        dispatch.memcmp = dispatch.strlen = "swar";
+    }
+
+    return &dispatch;
+}
+
+const struct string_dispatch *string_dispatch_current() {
+    return &dispatch;
+}
+
+void *memcpy(void *dest, const void *src, usize n) {
+    return memcpy_impl(dest, src, n);
+}
+void *memset(void *s, int c, usize n) {
+    return memset_impl(s, c, n);
+}
+void *memmove(void *dest, const void *src, usize n) {
+    return memmove_impl(dest, src, n);
+}
+usize strlen(const char *str) {
+    return strlen_impl(str);
+}
+
+void *memchr(const void *s, int c, usize n) {
+    const u8 *p = (const u8 *)s;
+    u8 ch = (u8)c;
+    while (n && ((usize)p & 7)) {
+        if (*p == ch) return (void *)p;
+        p++; n--;
+    }
+    u64 rep = ONES * ch;
+    while (n >= 8) {
+        u64 m = HAS_ZERO(*(const u64 *)p ^ rep);
+        if (m) return (void *)(p + (__builtin_ctzll(m) >> 3));
+        p += 8; n -= 8;
     }
-    return len;
+    while (n--) {
+        if (*p == ch) return (void *)p;
+        p++;
+    }
+    return nullptr;
+}
+
+void *memrchr(const void *s, int c, usize n) {
+    const u8 *p = (const u8 *)s + n;
+    u8 ch = (u8)c;
+    while (n && ((usize)p & 7)) {
+        p--; n--;
+        if (*p == ch) return (void *)p;
+    }
+    u64 rep = ONES * ch;
+    while (n >= 8) {
+        p -= 8; n -= 8;
+        u64 x = *(const u64 *)p ^ rep;
+        // only the lowest flag of HAS_ZERO is exact, so locate the last
+        // match bytewise once the word is known to contain one
+        if (HAS_ZERO(x)) {
+            for (int i = 7; i >= 0; i--) {
+                if (p[i] == ch) return (void *)(p + i);
+            }
+        }
+    }
+    while (n--) {
+        p--;
+        if (*p == ch) return (void *)p;
+    }
+    return nullptr;
 }
 
 void reverse_str(char *str, usize length) {
@@ -54,63 +364,106 @@ void reverse_str(char *str, usize length) {
     }
 }
 
-char* itoa(s64 value, char *str, int base) {
-    if (base < 2 || base > 36) {
-        str[0] = '\0';
-        return str;
-    }
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
 
-    const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    s64 num = value;
-    usize i = 0;
-    int is_negative = 0;
+static const u64 pow10_table[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
 
-    if (num == 0) {
-        str[i++] = '0';
-        str[i] = '\0';
-        return str;
-    }
+usize count_dec_digits(u64 value) {
+    if (value < 10) return 1;
+    // log10(2) ~= 1233/4096 turns the bit length into a digit estimate that
+    // is at most one short; a single table compare corrects it
+    u32 t = ((64 - __builtin_clzll(value)) * 1233) >> 12;
+    return t + (value >= pow10_table[t]);
+}
 
-    if (num < 0 && base == 10) {
-        is_negative = 1;
-        num = -num;
-    }
+usize count_hex_digits(u64 value) {
+    return (64 - __builtin_clzll(value | 1) + 3) >> 2;
+}
 
-    while (num != 0) {
-        int rem = num % base;
-        str[i++] = digits[rem];
-        num /= base;
+usize u64_to_dec(char *buf, u64 value) {
+    usize n = count_dec_digits(value);
+    char *p = buf + n;
+    while (value >= 100) {
+        u32 r = (u32)(value % 100) * 2;
+        value /= 100;
+        p -= 2;
+        p[0] = digit_pairs[r];
+        p[1] = digit_pairs[r + 1];
     }
-
-    if (is_negative) {
-        str[i++] = '-';
+    if (value >= 10) {
+        p -= 2;
+        p[0] = digit_pairs[value * 2];
+        p[1] = digit_pairs[value * 2 + 1];
+    } else {
+        *--p = '0' + value;
     }
+    return n;
+}
 
-    str[i] = '\0';
-    reverse_str(str, i);
-
-    return str;
+usize s64_to_dec(char *buf, s64 value) {
+    if (value < 0) {
+        *buf = '-';
+        // negate in unsigned space so INT64_MIN survives
+        return 1 + u64_to_dec(buf + 1, -(u64)value);
+    }
+    return u64_to_dec(buf, value);
 }
 
-char* itoa_hex(u64 value, char *str) {
+usize u64_to_hex(char *buf, u64 value) {
     const char hex_digits[] = "0123456789abcdef";
-    usize i = 0;
+    usize n = count_hex_digits(value);
+    char *p = buf + n;
+    while (p > buf) {
+        *--p = hex_digits[value & 0xF];
+        value >>= 4;
+    }
+    return n;
+}
 
-    if (value == 0) {
-        str[i++] = '0';
-        str[i] = '\0';
+char* itoa(s64 value, char *str, int base) {
+    if (base < 2 || base > 36) {
+        str[0] = '\0';
         return str;
     }
-
-    while (value != 0) {
-        int rem = value & 0xF;
-        str[i++] = hex_digits[rem];
-        value >>= 4;
+    if (base == 10) {
+        str[s64_to_dec(str, value)] = '\0';
+        return str;
     }
 
-    str[i] = '\0';
-    reverse_str(str, i);
+    // other bases print the two's complement bit pattern, right to left
+    const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char tmp[64];
+    char *p = tmp + sizeof(tmp);
+    u64 num = (u64)value;
+    do {
+        *--p = digits[num % base];
+        num /= base;
+    } while (num);
+
+    usize n = tmp + sizeof(tmp) - p;
+    memcpy(str, p, n);
+    str[n] = '\0';
+    return str;
+}
 
+char* itoa_hex(u64 value, char *str) {
+    str[u64_to_hex(str, value)] = '\0';
     return str;
 }
 
@@ -133,72 +486,164 @@ void strcat(char *dest, const char *src) {
     dest[bpos+slen] = '\0';
 }
 
-u16 strcmp(const char *str1, const char *str2) {
-    if (strlen(str1) != strlen(str2)) {
-        return 1;
-    }
-    for (usize i = 0; i < strlen(str1); i++) {
-        if (str1[i] != str2[i]) {
-            return 1;
+int strcmp(const char *str1, const char *str2) {
+    const u8 *a = (const u8 *)str1;
+    const u8 *b = (const u8 *)str2;
+    for (;;) {
+        if (WORD_SAFE(a) && WORD_SAFE(b)) {
+            u64 x = *(const u64_ua *)a;
+            u64 y = *(const u64_ua *)b;
+            u64 m = (x ^ y) | HAS_ZERO(x);
+            if (m) return diff_byte(x, y, m);
+            a += 8; b += 8;
+        } else {
+            if (*a != *b || !*a) return *a - *b;
+            a++; b++;
         }
     }
-    return 0;
 }
 
-bool memcmp(const void *ptr1, const void *ptr2, u32 n) {
-    const u8 *p1 = (const u8 *)ptr1;
-    const u8 *p2 = (const u8 *)ptr2;
-    for (u32 i = 0; i < n; i++) {
-        if (p1[i] != p2[i]) {
-            return 1;
+int strncmp(const char *str1, const char *str2, usize n) {
+    const u8 *a = (const u8 *)str1;
+    const u8 *b = (const u8 *)str2;
+    while (n) {
+        if (n >= 8 && WORD_SAFE(a) && WORD_SAFE(b)) {
+            u64 x = *(const u64_ua *)a;
+            u64 y = *(const u64_ua *)b;
+            u64 m = (x ^ y) | HAS_ZERO(x);
+            if (m) return diff_byte(x, y, m);
+            a += 8; b += 8; n -= 8;
+        } else {
+            if (*a != *b || !*a) return *a - *b;
+            a++; b++; n--;
         }
     }
     return 0;
 }
 
-char *strtok(const char *str, const char *delim) {
-    static char *token = nullptr;
-    if (str) {
-        token = (char*)str;
-    } else if (!token) {
+int memcmp(const void *ptr1, const void *ptr2, usize n) {
+    return memcmp_impl(ptr1, ptr2, n);
+}
+
+int bcmp(const void *ptr1, const void *ptr2, usize n) {
+    const u8 *a = (const u8 *)ptr1;
+    const u8 *b = (const u8 *)ptr2;
+    u64 acc = 0;
+    while (n >= 32) {
+        acc |= ((const u64_ua *)a)[0] ^ ((const u64_ua *)b)[0];
+        acc |= ((const u64_ua *)a)[1] ^ ((const u64_ua *)b)[1];
+        acc |= ((const u64_ua *)a)[2] ^ ((const u64_ua *)b)[2];
+        acc |= ((const u64_ua *)a)[3] ^ ((const u64_ua *)b)[3];
+        if (acc) return 1;
+        a += 32; b += 32; n -= 32;
+    }
+    while (n >= 8) {
+        acc |= *(const u64_ua *)a ^ *(const u64_ua *)b;
+        a += 8; b += 8; n -= 8;
+    }
+    while (n--) acc |= *a++ ^ *b++;
+    return acc != 0;
+}
+
+void char_set_init(struct char_set *set, const char *chars) {
+    set->bits[0] = set->bits[1] = set->bits[2] = set->bits[3] = 0;
+    for (const u8 *p = (const u8 *)chars; *p; p++) {
+        set->bits[*p >> 6] |= 1ULL << (*p & 63);
+    }
+}
+
+char *strtok_r(char *str, const char *delim, char **saveptr) {
+    char *p = str ? str : *saveptr;
+    if (!p) {
         return nullptr;
     }
-    char *start = token;
-    token += strspn(token, delim);
-    if (!*token) {
+    struct char_set set;
+    char_set_init(&set, delim);
+    while (char_set_has(&set, *p)) p++;
+    if (!*p) {
+        *saveptr = nullptr;
         return nullptr;
     }
-    token += strcspn(token, delim);
-    if (*token) {
-        *token++ = '\0';
+    char *start = p;
+    set.bits[0] |= 1;
+    while (!char_set_has(&set, *p)) p++;
+    if (*p) {
+        *p++ = '\0';
+        *saveptr = p;
+    } else {
+        *saveptr = nullptr;
     }
     return start;
 }
 
-usize strspn( const char* dest, const char* src ) {
-    usize count = 0;
-    while (*dest && strchr(src, *dest++)) {
-        count++;
+char *strtok(const char *str, const char *delim) {
+    static char *token = nullptr;
+    return strtok_r((char*)str, delim, &token);
+}
+
+void str_tokenizer_init(struct str_tokenizer *tok, const char *str, usize len, const char *delims) {
+    tok->cur = str;
+    tok->end = str + len;
+    char_set_init(&tok->delims, delims);
+}
+
+bool str_tokenizer_next(struct str_tokenizer *tok, struct str_view *out) {
+    const char *p = tok->cur;
+    const char *end = tok->end;
+    while (p < end && char_set_has(&tok->delims, *p)) p++;
+    if (p == end) {
+        tok->cur = p;
+        return false;
     }
-    return count;
+    const char *start = p;
+    while (p < end && !char_set_has(&tok->delims, *p)) p++;
+    out->ptr = start;
+    out->len = p - start;
+    tok->cur = p;
+    return true;
+}
+
+usize strspn( const char* dest, const char* src ) {
+    struct char_set set;
+    char_set_init(&set, src);
+    const char *p = dest;
+    // the terminator is never in the set, so it ends the span by itself
+    while (char_set_has(&set, *p)) p++;
+    return p - dest;
 }
 
 usize strcspn( const char *dest, const char *src ) {
-    usize count = 0;
-    while (*dest && !strchr(src, *dest++)) {
-        count++;
-    }
-    return count;
+    struct char_set set;
+    char_set_init(&set, src);
+    // the terminator is part of the set so the loop needs a single test
+    set.bits[0] |= 1;
+    const char *p = dest;
+    while (!char_set_has(&set, *p)) p++;
+    return p - dest;
 }
 
 const char* strchr( const char* str, int ch ) {
-    while (*str) {
-        if (*str == ch) {
-            return str;
+    const char *p = str;
+    char c = (char)ch;
+    while ((usize)p & 7) {
+        if (*p == c) return p;
+        if (!*p) return nullptr;
+        p++;
+    }
+    const u64 *w = (const u64 *)p;
+    u64 rep = ONES * (u8)c;
+    for (;;) {
+        u64 zm = HAS_ZERO(*w);
+        u64 cm = HAS_ZERO(*w ^ rep);
+        if (zm | cm) {
+            // bytes past the terminator don't count, so take the earlier hit
+            u32 zi = zm ? __builtin_ctzll(zm) : 64;
+            u32 ci = cm ? __builtin_ctzll(cm) : 64;
+            if (ci <= zi) return (const char *)w + (ci >> 3);
+            return nullptr;
         }
-        str++;
+        w++;
     }
-    return nullptr;
 }
 
 void strcpy(char *dest, const char *src) {
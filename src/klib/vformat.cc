@@ -1,243 +1,291 @@
 #include <stdarg.h>
 #include <klib/string.h>
 #include <klib/intx.h>
+#include <klib/format.h>
 
-void pad_string(char *dest, const char *src, int width, bool zero_pad, bool has_prefix) {
-    int src_len = strlen(src);
-    
-    if (width <= src_len) {
-        strcpy(dest, src);
+static void out_flush(struct fmt_buf *out) {
+    if (out->len) {
+        out->sink->write(out->sink->ctx, out->buf, out->len);
+        out->flushed += out->len;
+        out->len = 0;
+    }
+}
+
+static void out_str(struct fmt_buf *out, const char *s, usize n) {
+    usize room = out->cap - out->len;
+    if (n <= room) {
+        memcpy(out->buf + out->len, s, n);
+        out->len += n;
         return;
     }
-    
-    int pad_len = width - src_len;
-    int dest_pos = 0;
-    
-    if (has_prefix && zero_pad) {
-        dest[dest_pos++] = src[0]; // '0'
-        dest[dest_pos++] = src[1]; // 'x'
-        for (int i = 0; i < pad_len; i++) {
-            dest[dest_pos++] = '0';
-        }
-        strcpy(dest + dest_pos, src + 2);
-    } else if (has_prefix && !zero_pad) {
-        for (int i = 0; i < pad_len; i++) {
-            dest[dest_pos++] = ' ';
-        }
-        strcpy(dest + dest_pos, src);
-    } else if (!has_prefix && zero_pad) {
-        for (int i = 0; i < pad_len; i++) {
-            dest[dest_pos++] = '0';
+    if (!out->sink) {
+        memcpy(out->buf + out->len, s, room);
+        out->len += room;
+        out->flushed += n - room;
+        return;
+    }
+    out_flush(out);
+    if (n >= out->cap) {
+        // large runs go straight to the sink instead of through the batch
+        out->sink->write(out->sink->ctx, s, n);
+        out->flushed += n;
+    } else {
+        memcpy(out->buf, s, n);
+        out->len = n;
+    }
+}
+
+static inline void out_char(struct fmt_buf *out, char c) {
+    if (out->len < out->cap) {
+        out->buf[out->len++] = c;
+    } else {
+        out_str(out, &c, 1);
+    }
+}
+
+static void out_fill(struct fmt_buf *out, char c, usize n) {
+    while (n) {
+        usize room = out->cap - out->len;
+        if (!room) {
+            if (!out->sink) {
+                out->flushed += n;
+                return;
+            }
+            out_flush(out);
+            room = out->cap;
         }
-        strcpy(dest + dest_pos, src);
+        usize k = n < room ? n : room;
+        memset(out->buf + out->len, c, k);
+        out->len += k;
+        n -= k;
+    }
+}
+
+// Emits prefix and the padding for n digits to follow; zero padding goes
+// between the prefix and the digits, space padding before both.
+static void out_prefix(struct fmt_buf *out, const char *prefix, usize prefix_len,
+                       usize n, int width, bool zero_pad) {
+    usize total = prefix_len + n;
+    usize pad = (width > 0 && (usize)width > total) ? (usize)width - total : 0;
+    if (zero_pad) {
+        out_str(out, prefix, prefix_len);
+        out_fill(out, '0', pad);
     } else {
-        for (int i = 0; i < pad_len; i++) {
-            dest[dest_pos++] = ' ';
+        out_fill(out, ' ', pad);
+        out_str(out, prefix, prefix_len);
+    }
+}
+
+// Emits prefix and digits padded to width in a single write sequence.
+static void out_number(struct fmt_buf *out, const char *prefix, usize prefix_len,
+                       const char *digits, usize n, int width, bool zero_pad) {
+    out_prefix(out, prefix, prefix_len, n, width, zero_pad);
+    out_str(out, digits, n);
+}
+
+static const char hex_digits[] = "0123456789abcdef";
+
+void fmt_put(struct fmt_buf *out, const char *s, usize n) {
+    out_str(out, s, n);
+}
+
+void fmt_flush(struct fmt_buf *out) {
+    out_flush(out);
+}
+
+void fmt_put_int(struct fmt_buf *out, u64 mag, bool neg, const struct fmt_spec *spec) {
+    char tmp[24];
+    usize n;
+    switch (spec->conv) {
+    case 'd':
+        n = u64_to_dec(tmp, mag);
+        out_number(out, "-", neg, tmp, n, spec->width, spec->zero_pad);
+        break;
+    case 'u':
+        n = u64_to_dec(tmp, mag);
+        out_number(out, "", 0, tmp, n, spec->width, spec->zero_pad);
+        break;
+    case 'x':
+        n = u64_to_hex(tmp, mag);
+        out_number(out, "0x", spec->alt ? 2 : 0, tmp, n, spec->width, spec->zero_pad);
+        break;
+    case 'p':
+        n = u64_to_hex(tmp, mag);
+        out_number(out, "0x", 2, tmp, n, spec->width, spec->zero_pad);
+        break;
+    case 'a':
+        // for dates and times which need to be exactly 2 digits
+        n = u64_to_dec(tmp, mag);
+        out_number(out, "-", neg, tmp, n, spec->width > 0 ? spec->width : 2, true);
+        break;
+    case 'c':
+        out_char(out, (char)mag);
+        break;
+    }
+}
+
+// Widest value %q conversions accept: 4096 bits.
+#define FMT_UINT_MAX_LIMBS 64
+
+// Streams the limbs in hex without leading zeros, one limb at a time so the
+// widest values need no digit buffer of their own.
+static void put_uint_hex(struct fmt_buf *out, const u64 *limbs, usize top, const struct fmt_spec *spec) {
+    char tmp[16];
+    usize first = u64_to_hex(tmp, limbs[top]);
+    out_prefix(out, "0x", spec->alt ? 2 : 0, first + top * 16, spec->width, spec->zero_pad);
+    out_str(out, tmp, first);
+
+    for (usize i = top; i-- > 0;) {
+        u64 limb = limbs[i];
+        for (int j = 15; j >= 0; j--) {
+            tmp[j] = hex_digits[limb & 0xF];
+            limb >>= 4;
         }
-        strcpy(dest + dest_pos, src);
+        out_str(out, tmp, 16);
     }
 }
 
-void quadtoa_hex(char *buffer, u512 n) {
-  char tmp[NLIMBS_512 * 16 + 1];
-  int pos = 0;
-  for (int i = NLIMBS_512 - 1; i >= 0; i--) {
-      u64 limb = n.limbs[i];
-      for (int j = 15; j >= 0; j--) {
-          u8 nibble = (limb >> (j * 4)) & 0xF;
-          tmp[pos++] = nibble < 10 ? '0' + nibble : 'a' + nibble - 10;
-      }
-  }
-  tmp[pos] = '\0';
-  char *p = tmp;
-  while (*p == '0' && *(p + 1) != '\0') {
-      p++;
-  }
-  strcpy(buffer, p);
+// Peels 19-digit chunks off a copy of the value, one single-limb division
+// pass per chunk over a shrinking span, then prints them most significant
+// first with every chunk but the leading one zero-filled to 19 digits.
+static void put_uint_dec(struct fmt_buf *out, const u64 *limbs, usize top, const struct fmt_spec *spec) {
+    u64 x[FMT_UINT_MAX_LIMBS];
+    u64 chunks[FMT_UINT_MAX_LIMBS + 2];
+    usize len = top + 1;
+    memcpy(x, limbs, len * sizeof(u64));
+
+    usize count = 0;
+    do {
+        chunks[count++] = intx::div_small(x, len, INTX_DEC_CHUNK_RADIX);
+        while (len > 0 && x[len - 1] == 0) len--;
+    } while (len);
+
+    char tmp[24];
+    usize first = u64_to_dec(tmp, chunks[count - 1]);
+    out_prefix(out, "", 0, first + (count - 1) * INTX_DEC_CHUNK, spec->width, spec->zero_pad);
+    out_str(out, tmp, first);
+    for (usize i = count - 1; i-- > 0;) {
+        usize n = u64_to_dec(tmp, chunks[i]);
+        out_fill(out, '0', INTX_DEC_CHUNK - n);
+        out_str(out, tmp, n);
+    }
 }
 
-void vsprintf(char *buffer, const char *format, va_list args) {
-    usize b_pos=0;
-    usize f_pos=0;
-    bool ext_prefix = false;
-    bool v_long = false;
-    bool v_quad = false;
-    bool zero_pad = false;
-    int width = 0;
-    while (format[f_pos]) {
-        if (format[f_pos] == '%') {
-            f_pos++;
-            ext_prefix = false;
-            v_long = false;
-            v_quad = false;
-            zero_pad = false;
-            width = 0;
-            
-            if (format[f_pos] == '#') { ext_prefix = true; f_pos++; }
-            if (format[f_pos] == '0') { zero_pad = true; f_pos++; }
-            
-            while (format[f_pos] >= '0' && format[f_pos] <= '9') {
-                width = width * 10 + (format[f_pos] - '0');
-                f_pos++;
-            }
-            
-            if (format[f_pos] == 'l') { 
-                v_long = true; 
-                f_pos++; 
-                if (format[f_pos] == 'l') {
-                    f_pos++; 
-                }
-            }
-            if (format[f_pos] == 'q') { v_quad = true; f_pos++; }
-            if (format[f_pos] == '%') {
-                buffer[b_pos] = '%';
-            }
-            else if (format[f_pos] == 'd') {
-                s64 i = 0;
-                if (v_long) { i = va_arg(args, s64); }
-                else { i = va_arg(args, int); }
-                char str[64];
-                char temp_str[32];
-                itoa(i, temp_str, 10);
-                
-                if (width > 0) {
-                    pad_string(str, temp_str, width, zero_pad, false);
-                } else {
-                    strcpy(str, temp_str);
-                }
-                
-                memcpy(buffer+b_pos, str, strlen(str));
-                b_pos += strlen(str)-1;
-            }
-            else if (format[f_pos] == 'u') {
-                u64 i = 0;
-                if (v_long) { i = va_arg(args, u64); }
-                else { i = va_arg(args, unsigned int); }
-                char str[64];
-                char temp_str[32];
-                
-                if (i == 0) {
-                    strcpy(temp_str, "0");
-                } else {
-                    char reversed[32];
-                    int pos = 0;
-                    while (i > 0) {
-                        reversed[pos++] = '0' + (i % 10);
-                        i /= 10;
-                    }
-                    for (int j = 0; j < pos; j++) {
-                        temp_str[j] = reversed[pos - 1 - j];
-                    }
-                    temp_str[pos] = '\0';
-                }
-                
-                if (width > 0) {
-                    pad_string(str, temp_str, width, zero_pad, false);
-                } else {
-                    strcpy(str, temp_str);
-                }
-                
-                memcpy(buffer+b_pos, str, strlen(str));
-                b_pos += strlen(str)-1;
-            }
-            else if (format[f_pos] == 'x') {
-                if (v_quad) {
-                    u512 v = va_arg(args, u512);
-                    char str[128];
-                    char temp_str[128];
-                    if (ext_prefix) { temp_str[0] = '0'; temp_str[1]='x'; }
-                    quadtoa_hex(temp_str + (ext_prefix ? 2 : 0), v);
-                    
-                    if (width > 0) {
-                        pad_string(str, temp_str, width, zero_pad, ext_prefix);
-                    } else {
-                        strcpy(str, temp_str);
-                    }
-                    
-                    memcpy(buffer+b_pos, str, strlen(str));
-                    b_pos += strlen(str)-1;
-                } else {
-                  s64 i = 0;
-                  if (v_long) { i = va_arg(args, s64); }
-                  else { i = va_arg(args, int); }
-                  char str[64];
-                  char temp_str[32];
-                  if (ext_prefix) { temp_str[0] = '0'; temp_str[1]='x'; }
-                  itoa_hex(i, temp_str + (ext_prefix ? 2 : 0));
-                  
-                  if (width > 0) {
-                      pad_string(str, temp_str, width, zero_pad, ext_prefix);
-                  } else {
-                      strcpy(str, temp_str);
-                  }
-                  
-                  memcpy(buffer+b_pos, str, strlen(str));
-                  b_pos += strlen(str)-1;
-                }
-            }
-            else if (format[f_pos] == 'p') {
-                s64 i = va_arg(args, s64);
-                char str[64];
-                char temp_str[32];
-                temp_str[0] = '0';
-                temp_str[1] = 'x';
-                itoa_hex(i, temp_str+2);
-                
-                if (width > 0) {
-                    pad_string(str, temp_str, width, zero_pad, true);
-                } else {
-                    strcpy(str, temp_str);
-                }
-                
-                memcpy(buffer+b_pos, str, strlen(str));
-                b_pos += strlen(str)-1;
-            }
-            else if (format[f_pos] == 's') {
-                char *s = va_arg(args, char *);
-                if (!s) {
-                    s = (char*)"(null)";
-                }
-                else if (s[0] == 0) {
-                    s = (char*)"(empty)";
-                }
-                memcpy(buffer+b_pos, s, strlen(s));
-                b_pos += strlen(s)-1;
-            }
-            else if (format[f_pos] == 'a') {
-                // for dates and times which need to be exactly 2 digits
-                char str[64];
-                char temp_str[32];
-                u8 off = 0;
-                int i = va_arg(args, int);
-                
-                int actual_width = (width > 0) ? width : 2;
-                
-                if (i < 10 && actual_width >= 2) {
-                    temp_str[0] = '0';
-                    off = 1;
-                }
-                itoa(i, temp_str+off, 10);
-                
-                if (actual_width > (int)strlen(temp_str)) {
-                    pad_string(str, temp_str, actual_width, true, false);
-                } else {
-                    strcpy(str, temp_str);
-                }
-                
-                memcpy(buffer+b_pos, str, strlen(str));
-                b_pos += strlen(str)-1;
+void fmt_put_uint(struct fmt_buf *out, const u64 *limbs, usize n, const struct fmt_spec *spec) {
+    usize top = n - 1;
+    while (top > 0 && limbs[top] == 0) top--;
+    if (spec->conv == 'x') {
+        put_uint_hex(out, limbs, top, spec);
+    } else {
+        put_uint_dec(out, limbs, top, spec);
+    }
+}
+
+void fmt_put_str(struct fmt_buf *out, const char *s, usize n, const struct fmt_spec *spec) {
+    out_number(out, "", 0, s, n, spec->width, false);
+}
+
+void fmt_put_cstr(struct fmt_buf *out, const char *s, const struct fmt_spec *spec) {
+    if (!s) {
+        s = "(null)";
+    } else if (s[0] == 0) {
+        s = "(empty)";
+    }
+    fmt_put_str(out, s, strlen(s), spec);
+}
+
+static void format_core(struct fmt_buf *out, const char *format, va_list args) {
+    const char *f = format;
+    while (*f) {
+        if (*f != '%') {
+            // copy the literal run up to the next conversion in one go
+            const char *run = f;
+            while (*f && *f != '%') f++;
+            out_str(out, run, f - run);
+            continue;
+        }
+
+        struct fmt_spec spec;
+        f = fmt_parse_spec(f + 1, &spec);
+
+        switch (spec.conv) {
+        case '\0':
+            return;
+        case '%':
+            out_char(out, '%');
+            break;
+        case 'd':
+        case 'a': {
+            if (spec.quad && spec.conv == 'd') {
+                u512 v = va_arg(args, u512);
+                fmt_put_uint(out, v.limbs, NLIMBS_512, &spec);
+                break;
             }
-            else if (format[f_pos] == 'c') {
-                char c = va_arg(args, int);
-                buffer[b_pos] = c;
+            s64 i = spec.is_long ? va_arg(args, s64) : va_arg(args, int);
+            fmt_put_int(out, i < 0 ? -(u64)i : (u64)i, i < 0, &spec);
+            break;
+        }
+        case 'u':
+        case 'x':
+            if (spec.quad) {
+                u512 v = va_arg(args, u512);
+                fmt_put_uint(out, v.limbs, NLIMBS_512, &spec);
+            } else {
+                u64 i = spec.is_long ? va_arg(args, u64) : va_arg(args, unsigned int);
+                fmt_put_int(out, i, false, &spec);
             }
-        } else {
-            buffer[b_pos] = format[f_pos];
+            break;
+        case 'p':
+            fmt_put_int(out, va_arg(args, u64), false, &spec);
+            break;
+        case 'c':
+            fmt_put_int(out, (u8)va_arg(args, int), false, &spec);
+            break;
+        case 's':
+            fmt_put_cstr(out, va_arg(args, const char *), &spec);
+            break;
+        default:
+            break;
         }
-        b_pos++;
-        f_pos++;
+        f++;
     }
-    buffer[b_pos] = 0;
+}
+
+usize vsnprintf(char *buffer, usize size, const char *format, va_list args) {
+    struct fmt_buf out = {buffer, size ? size - 1 : 0, 0, 0, nullptr};
+    format_core(&out, format, args);
+    if (size) {
+        buffer[out.len] = 0;
+    }
+    return out.flushed + out.len;
+}
+
+usize snprintf(char *buffer, usize size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    usize len = vsnprintf(buffer, size, format, args);
+    va_end(args);
+    return len;
+}
+
+usize vformat_to(struct fmt_sink sink, const char *format, va_list args) {
+    char chunk[FMT_CHUNK];
+    struct fmt_buf out = {chunk, sizeof(chunk), 0, 0, &sink};
+    format_core(&out, format, args);
+    out_flush(&out);
+    return out.flushed;
+}
+
+usize format_to(struct fmt_sink sink, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    usize len = vformat_to(sink, format, args);
+    va_end(args);
+    return len;
+}
+
+void vsprintf(char *buffer, const char *format, va_list args) {
+    vsnprintf(buffer, (usize)-1, format, args);
 }
 
 void sprintf(char *buffer, const char *format, ...) {